@@ -25,10 +25,16 @@
 #include <linux/netlink.h>
 
 
+#define UV_IO_PRIVATE_PLATFORM_FIELDS                                         \
+  unsigned int edge;                                                          \
+  unsigned int ready;                                                         \
+
 #define UV_PLATFORM_LOOP_FIELDS                                               \
   uv__io_t inotify_read_watcher;                                              \
   void* inotify_watchers;                                                     \
   int inotify_fd;                                                             \
+  void* udp_mmsg;                                                             \
+  void* iou;                                                                  \
 
 #define UV_PLATFORM_FS_EVENT_FIELDS                                           \
   void* watchers[2];                                                          \
@@ -32,6 +32,13 @@ struct uv__work {
   void (*done)(struct uv__work *w, int status);
   struct uv_loop_s* loop;
   void* wq[2];
+  unsigned int shard;
+  unsigned int cls;
+  unsigned int type;
+  unsigned int tracked;
+  unsigned int queued_at;  /* Microseconds. */
+  unsigned int wait_time;
+  unsigned int run_time;
 };
 
 #endif /* UV_THREADPOOL_H_ */
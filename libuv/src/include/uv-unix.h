@@ -213,9 +213,11 @@ typedef struct {
   uv__io_t** watchers;                                                        \
   unsigned int nwatchers;                                                     \
   unsigned int nfds;                                                          \
-  void* wq[2];                                                                \
-  uv_mutex_t wq_mutex;                                                        \
+  void* wq;                                                                   \
   uv_async_t wq_async;                                                        \
+  void* wq_stats;                                                             \
+  void* wq_batch[2];                                                          \
+  unsigned int wq_batch_depth;                                                \
   uv_rwlock_t cloexec_lock;                                                   \
   uv_handle_t* closing_handles;                                               \
   void* process_handles[1][2];                                                \
@@ -229,6 +231,10 @@ typedef struct {
     unsigned int nelts;                                                       \
   } timer_heap;                                                               \
   uint64_t timer_counter;                                                     \
+  void* timer_wheel;                                                          \
+  unsigned int timer_slack;                                                   \
+  void* read_pool;                                                            \
+  void* flush_queue[2];                                                       \
   uint64_t time;                                                              \
   int signal_pipefd[2];                                                       \
   uv__io_t signal_io_watcher;                                                 \
@@ -249,10 +255,18 @@ typedef struct {
   unsigned int nbufs;                                                         \
   int error;                                                                  \
   uv_buf_t bufsml[4];                                                         \
+  unsigned int zerocopy_first;                                                \
+  unsigned int zerocopy_sent;                                                 \
+  unsigned int zerocopy_done;                                                 \
+  int file;                                                                   \
+  int64_t file_offset;                                                        \
 
 #define UV_CONNECT_PRIVATE_FIELDS                                             \
   void* queue[2];                                                             \
 
+#define UV_CONNECT_HOST_PRIVATE_FIELDS                                        \
+  void* state;                                                                \
+
 #define UV_SHUTDOWN_PRIVATE_FIELDS /* empty */
 
 #define UV_UDP_SEND_PRIVATE_FIELDS                                            \
@@ -262,6 +276,7 @@ typedef struct {
   uv_buf_t* bufs;                                                             \
   ssize_t status;                                                             \
   uv_udp_send_cb send_cb;                                                     \
+  unsigned int segment_size;                                                  \
   uv_buf_t bufsml[4];                                                         \
 
 #define UV_HANDLE_PRIVATE_FIELDS                                              \
@@ -278,9 +293,21 @@ typedef struct {
   int delayed_error;                                                          \
   int accepted_fd;                                                            \
   void* queued_fds;                                                           \
+  void* splice[2];                                                            \
+  void* flush_queue[2];                                                       \
+  uv_watermark_cb watermark_cb;                                               \
+  void* frame;                                                                \
+  size_t write_high;                                                          \
+  size_t write_low;                                                           \
   UV_STREAM_PRIVATE_PLATFORM_FIELDS                                           \
 
-#define UV_TCP_PRIVATE_FIELDS /* empty */
+#define UV_TCP_PRIVATE_FIELDS                                                 \
+  void* zerocopy_queue[2];                                                    \
+  size_t zerocopy_threshold;                                                  \
+  unsigned int zerocopy_next;                                                 \
+  unsigned int zerocopy_pending;                                              \
+  unsigned int notsent_lowat;                                                 \
+  void* connect_host_req;                                                     \
 
 #define UV_UDP_PRIVATE_FIELDS                                                 \
   uv_alloc_cb alloc_cb;                                                       \
@@ -379,4 +406,26 @@ typedef struct {
   uv_fs_event_cb cb;                                                          \
   UV_PLATFORM_FS_EVENT_FIELDS                                                 \
 
+#define UV_CLUSTER_PRIVATE_FIELDS                                             \
+  uv_cluster_exit_cb exit_cb;                                                 \
+  uv_cluster_close_cb close_cb;                                               \
+  void* workers[2];                                                           \
+  void* next_worker;                                                          \
+  unsigned int flags;                                                         \
+
+#define UV_CLUSTER_WORKER_PRIVATE_FIELDS                                      \
+  uv_stream_t* accept_from;                                                   \
+  uv_write_t done_req;                                                        \
+  unsigned int done_count;                                                    \
+  unsigned int flags;                                                         \
+  char buf[64];                                                               \
+
+#define UV_SPLICE_PRIVATE_FIELDS                                              \
+  uv_splice_cb cb;                                                            \
+  int fds[2];                                                                 \
+  char* buf;                                                                  \
+  size_t offset;                                                              \
+  size_t size;                                                                \
+  unsigned int flags;                                                         \
+
 #endif /* UV_UNIX_H */
@@ -380,6 +380,9 @@ RB_HEAD(uv_timer_tree_s, uv_timer_s);
 #define UV_CONNECT_PRIVATE_FIELDS                                             \
   /* empty */
 
+#define UV_CONNECT_HOST_PRIVATE_FIELDS                                        \
+  /* empty */
+
 #define UV_SHUTDOWN_PRIVATE_FIELDS                                            \
   /* empty */
 
@@ -637,6 +640,15 @@ RB_HEAD(uv_timer_tree_s, uv_timer_s);
   struct uv_req_s signal_req;                                                 \
   unsigned long pending_signum;
 
+#define UV_CLUSTER_PRIVATE_FIELDS                                             \
+  void* reserved[4];
+
+#define UV_CLUSTER_WORKER_PRIVATE_FIELDS                                      \
+  void* reserved[4];
+
+#define UV_SPLICE_PRIVATE_FIELDS                                              \
+  void* reserved[4];
+
 int uv_utf16_to_utf8(const WCHAR* utf16Buffer, size_t utf16Size,
     char* utf8Buffer, size_t utf8Size);
 int uv_utf8_to_utf16(const char* utf8Buffer, WCHAR* utf16Buffer,
@@ -167,6 +167,7 @@ extern "C" {
   XX(WORK, work)                                                              \
   XX(GETADDRINFO, getaddrinfo)                                                \
   XX(GETNAMEINFO, getnameinfo)                                                \
+  XX(CONNECT_HOST, connect_host)                                              \
 
 typedef enum {
 #define XX(code, _) UV_ ## code = UV__ ## code,
@@ -220,6 +221,7 @@ typedef struct uv_getnameinfo_s uv_getnameinfo_t;
 typedef struct uv_shutdown_s uv_shutdown_t;
 typedef struct uv_write_s uv_write_t;
 typedef struct uv_connect_s uv_connect_t;
+typedef struct uv_connect_host_s uv_connect_host_t;
 typedef struct uv_udp_send_s uv_udp_send_t;
 typedef struct uv_fs_s uv_fs_t;
 typedef struct uv_work_s uv_work_t;
@@ -228,6 +230,9 @@ typedef struct uv_work_s uv_work_t;
 typedef struct uv_cpu_info_s uv_cpu_info_t;
 typedef struct uv_interface_address_s uv_interface_address_t;
 typedef struct uv_dirent_s uv_dirent_t;
+typedef struct uv_cluster_s uv_cluster_t;
+typedef struct uv_cluster_worker_s uv_cluster_worker_t;
+typedef struct uv_splice_s uv_splice_t;
 
 
 typedef enum {
@@ -276,6 +281,74 @@ UV_EXTERN int uv_loop_init(uv_loop_t* loop);
  */
 UV_EXTERN int uv_loop_close(uv_loop_t* loop);
 
+typedef enum {
+  UV_LOOP_EDGE_TRIGGERED,
+  UV_LOOP_THREADPOOL_STATS,
+  UV_LOOP_IO_URING,
+  UV_LOOP_TIMER_WHEEL,
+  UV_LOOP_TIMER_SLACK,
+  UV_LOOP_READ_BUFFER_POOL
+} uv_loop_option;
+
+/*
+ * Sets additional loop options.  You should normally call this before the
+ * first call to uv_run() unless mentioned otherwise.  Be prepared to handle
+ * UV_ENOSYS; it means the loop option is not supported by the platform.
+ *
+ * Supported options:
+ *  - UV_LOOP_EDGE_TRIGGERED: Use edge-triggered epoll for TCP, pipe and UDP
+ *    handles.  Their file descriptors are registered with the kernel once and
+ *    interest changes (e.g. uv_read_start() / uv_read_stop() for backpressure)
+ *    no longer cost a system call each.  Don't use it when polling
+ *    uv_backend_fd() from another event loop: readiness that libuv remembers
+ *    across iterations is not visible on that file descriptor.  Linux only.
+ *  - UV_LOOP_THREADPOOL_STATS: Collect statistics about the thread pool work
+ *    of this loop, see uv_threadpool_stats().  Can be set at any time and
+ *    stays on.
+ *  - UV_LOOP_IO_URING: Use io_uring as the poll backend instead of epoll.
+ *    File descriptors are watched with poll requests on the loop's ring and
+ *    each iteration submits them, together with pending file system
+ *    requests, and waits for events with a single system call.  TCP and
+ *    pipe handles also read and accept on the ring: the kernel reads into a
+ *    buffer of the loop (Linux 5.19 and up) that is copied into the one from
+ *    alloc_cb, so a readable stream costs no extra system call.  Writes are
+ *    tried right away as always and what doesn't fit is copied and handed to
+ *    the ring.  UDP and the other handles only poll.  Handles behave the same
+ *    as with epoll.  Set it right after uv_loop_init().  Can't be combined with
+ *    UV_LOOP_EDGE_TRIGGERED (UV_EINVAL).  Linux 5.11 and up, UV_ENOSYS on
+ *    older kernels or when io_uring is disabled with UV_USE_IO_URING=0.
+ *  - UV_LOOP_TIMER_WHEEL: Keep timers in a hierarchical timing wheel instead
+ *    of a binary heap.  uv_timer_start(), uv_timer_stop() and uv_timer_again()
+ *    take constant time, which pays off with many timers, e.g. an idle
+ *    timeout per connection.  Timers fire in the same order as with the heap.
+ *    Returns UV_EBUSY if the loop has active timers.
+ *  - UV_LOOP_TIMER_SLACK: Takes an unsigned int, the number of milliseconds
+ *    timers may fire late.  The loop then only wakes up for timers at
+ *    multiples of it, so timers that are due close together fire in the same
+ *    loop iteration instead of each costing a wakeup.  Useful with many
+ *    jittered timers, e.g. keepalives, on devices that should sleep as much as
+ *    possible.  0, the default, turns it off.  Can be set at any time.
+ *  - UV_LOOP_READ_BUFFER_POOL: Lets uv_read_start() and uv_udp_recv_start()
+ *    take a NULL alloc_cb, those handles then read into buffers from a pool
+ *    of the loop.  Handles started with an alloc_cb keep using it.  The
+ *    buffer is lent to the read callback and goes back to the pool when the
+ *    callback returns, unless the callback keeps it with uv_buf_retain().
+ *    Stream reads start with a small buffer and only move up to larger size
+ *    classes while reads fill them, so idle connections don't pin any
+ *    memory.  Can be set at any time.
+ */
+UV_EXTERN int uv_loop_configure(uv_loop_t* loop, uv_loop_option option, ...);
+
+/*
+ * Keep a buffer that the loop lent to a read callback, see
+ * UV_LOOP_READ_BUFFER_POOL.  Must be called from within the read callback.
+ * Retained buffers are handed back with uv_buf_release(), which must happen
+ * before the loop is closed.  Not for datagrams received with
+ * UV_UDP_MMSG_CHUNK set, those live in a separate loop-owned batch buffer.
+ */
+UV_EXTERN void uv_buf_retain(const uv_buf_t* buf);
+UV_EXTERN void uv_buf_release(uv_loop_t* loop, const uv_buf_t* buf);
+
 /*
  * Allocates and initializes a new loop.
  *
@@ -416,8 +489,10 @@ typedef void (*uv_read_cb)(uv_stream_t* stream,
                            const uv_buf_t* buf);
 typedef void (*uv_write_cb)(uv_write_t* req, int status);
 typedef void (*uv_connect_cb)(uv_connect_t* req, int status);
+typedef void (*uv_connect_host_cb)(uv_connect_host_t* req, int status);
 typedef void (*uv_shutdown_cb)(uv_shutdown_t* req, int status);
 typedef void (*uv_connection_cb)(uv_stream_t* server, int status);
+typedef void (*uv_watermark_cb)(uv_stream_t* handle, int above);
 typedef void (*uv_close_cb)(uv_handle_t* handle);
 typedef void (*uv_poll_cb)(uv_poll_t* handle, int status, int events);
 typedef void (*uv_timer_cb)(uv_timer_t* handle);
@@ -691,6 +766,42 @@ UV_EXTERN int uv_read_start(uv_stream_t*,
 
 UV_EXTERN int uv_read_stop(uv_stream_t*);
 
+enum uv_frame_flags {
+  /* Frames start with their length in 1, 2 or 4 bytes. The length doesn't
+   * include the prefix itself.
+   */
+  UV_FRAME_LENGTH8 = 1,
+  UV_FRAME_LENGTH16 = 2,
+  UV_FRAME_LENGTH32 = 4,
+  /* Length prefixes are big endian unless this flag is set. */
+  UV_FRAME_LITTLE_ENDIAN = 8,
+  /* Frames end with the delimiter byte, e.g. '\n'. */
+  UV_FRAME_DELIMITER = 16
+};
+
+/*
+ * Like uv_read_start() but the callback gets one call per complete frame,
+ * with buf pointing at the frame's payload: without the length prefix or
+ * the delimiter. nread is the payload's size and may be 0 for an empty
+ * frame. The data is only valid until the callback returns.
+ *
+ * Frames are reassembled in a buffer that the stream owns, there is no
+ * alloc_cb. A frame that arrives with a single read is handed out without
+ * copying it. A frame larger than `max_frame` bytes is reported as
+ * UV_EMSGSIZE, after which the framing is lost and the stream should be
+ * closed. A trailing incomplete frame is dropped at EOF.
+ *
+ * `flags` takes exactly one of UV_FRAME_LENGTH8, UV_FRAME_LENGTH16,
+ * UV_FRAME_LENGTH32 or UV_FRAME_DELIMITER, the latter uses `delimiter`.
+ * uv_read_stop() keeps buffered frames for when reading restarts with the
+ * same framing. Returns UV_ENOTSUP on Windows.
+ */
+UV_EXTERN int uv_read_start_framed(uv_stream_t* stream,
+                                   unsigned int flags,
+                                   int delimiter,
+                                   size_t max_frame,
+                                   uv_read_cb read_cb);
+
 
 /*
  * Write data to stream. Buffers are written in order. Example:
@@ -746,6 +857,26 @@ UV_EXTERN int uv_try_write(uv_stream_t* handle,
                            const uv_buf_t bufs[],
                            unsigned int nbufs);
 
+/*
+ * Write `length` bytes of `file`, starting at `offset`, to the stream. The
+ * request is queued behind and ahead of ordinary uv_write() requests, so the
+ * bytes appear on the stream in the order in which the writes were issued.
+ *
+ * The data is moved with a non-blocking sendfile() on the loop thread, there
+ * is no round trip through the threadpool. Platforms or file types that don't
+ * support sendfile() fall back to pread() and write(). The file position of
+ * `file` is not changed and `file` must stay open until the callback runs.
+ *
+ * The callback is called with UV_EIO if the file is shorter than the range.
+ * Not supported on Windows, this function returns UV_ENOTSUP there.
+ */
+UV_EXTERN int uv_write_file(uv_write_t* req,
+                            uv_stream_t* handle,
+                            uv_file file,
+                            int64_t offset,
+                            size_t length,
+                            uv_write_cb cb);
+
 /* uv_write_t is a subclass of uv_req_t. */
 struct uv_write_s {
   UV_REQ_FIELDS
@@ -783,6 +914,100 @@ UV_EXTERN int uv_is_writable(const uv_stream_t* handle);
  */
 UV_EXTERN int uv_stream_set_blocking(uv_stream_t* handle, int blocking);
 
+/*
+ * Enable or disable write batching for a stream.
+ *
+ * While enabled, write requests aren't attempted right away. The stream is
+ * flushed once per loop iteration, right before the loop polls for I/O, so
+ * all the uv_write() calls made from the callbacks of one iteration leave
+ * with a single writev() and end up in as few TCP segments as possible.
+ * uv_try_write() still writes immediately.
+ *
+ * Disabling batching flushes the stream. Returns UV_ENOTSUP on Windows.
+ */
+UV_EXTERN int uv_stream_set_cork(uv_stream_t* handle, int enable);
+
+/*
+ * Attempt the writes that batching is holding back now instead of waiting
+ * for the end of the loop iteration. A no-op when nothing is held back.
+ */
+UV_EXTERN int uv_stream_flush(uv_stream_t* handle);
+
+/*
+ * Get notified when the write queue of a stream fills up and drains.
+ *
+ * The callback runs with `above` set to 1 when write_queue_size reaches
+ * `high`, and with `above` set to 0 when it has fallen back to `low` after
+ * that. A relay can pause reading from the other side between the two calls
+ * and bound the memory per connection that way. The callback may run from
+ * within uv_write() and from within this function when the queue already
+ * holds `high` bytes or more.
+ *
+ * `low` must not be greater than `high`. A NULL callback turns notifications
+ * off. Returns UV_ENOTSUP on Windows. See also uv_tcp_notsent_lowat().
+ */
+UV_EXTERN int uv_stream_set_watermarks(uv_stream_t* handle,
+                                       size_t high,
+                                       size_t low,
+                                       uv_watermark_cb cb);
+
+
+/*
+ * uv_splice_t moves data from one stream to another inside the event loop,
+ * without handing it to alloc_cb and uv_write(). On Linux, TCP sockets and
+ * pipes are spliced through a kernel pipe and the data never enters user
+ * space. Elsewhere, or when splice(2) refuses the file descriptors, it's
+ * copied through a single buffer that's allocated when the splice starts.
+ *
+ * Reading from `source` pauses while `dest` can't keep up. When `source`
+ * reaches EOF and all data has been written, `dest` is shut down for writing
+ * if UV_SPLICE_SHUTDOWN is set, then the callback runs with status 0. On a
+ * read or write error the callback runs with the error. For a two-way relay,
+ * start a splice in each direction.
+ */
+enum uv_splice_flags {
+  /* Half-close `dest` when `source` reaches EOF. */
+  UV_SPLICE_SHUTDOWN = 1
+};
+
+typedef void (*uv_splice_cb)(uv_splice_t* splice, int status);
+
+struct uv_splice_s {
+  /* public */
+  void* data;
+  /* read-only */
+  uv_loop_t* loop;
+  uv_stream_t* source;
+  uv_stream_t* dest;
+  uint64_t bytes_read;
+  uint64_t bytes_written;
+  /* private */
+  UV_SPLICE_PRIVATE_FIELDS
+};
+
+/*
+ * Starts moving data from `source` to `dest`. Both must be connected TCP
+ * handles or non-IPC pipes, neither may be reading or have pending writes or
+ * a pending shutdown. Until the splice ends, both streams belong to it:
+ * uv_read_start(), uv_write() and uv_shutdown() on them return UV_EBUSY.
+ *
+ * Returns UV_EINVAL if the streams are unsuitable, UV_EBUSY if either is
+ * being read or written, by the user or by another splice.
+ */
+UV_EXTERN int uv_splice_start(uv_loop_t* loop,
+                              uv_splice_t* splice,
+                              uv_stream_t* source,
+                              uv_stream_t* dest,
+                              unsigned int flags,
+                              uv_splice_cb cb);
+
+/*
+ * Stops the splice without running the callback. Data that has been read
+ * from `source` but not yet written to `dest` is discarded. Closing either
+ * stream stops the splice in the same way.
+ */
+UV_EXTERN int uv_splice_stop(uv_splice_t* splice);
+
 
 /*
  * Used to determine whether a stream is closing or closed.
@@ -834,9 +1059,60 @@ UV_EXTERN int uv_tcp_keepalive(uv_tcp_t* handle,
  */
 UV_EXTERN int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable);
 
+/*
+ * Enable/disable exclusive wakeups for a listening socket that several loops
+ * watch, e.g. a file descriptor shared with uv_tcp_open() across threads.
+ * A new connection then wakes up one of the loops instead of all of them.
+ * Call it before uv_listen(). Linux 4.5 and up with the epoll backend,
+ * UV_ENOTSUP elsewhere.
+ */
+UV_EXTERN int uv_tcp_exclusive_accept(uv_tcp_t* handle, int enable);
+
+/*
+ * Enable/disable zero-copy transmission with MSG_ZEROCOPY.
+ *
+ * Write requests of at least `threshold` bytes are sent without copying the
+ * data into the kernel. Their write callbacks are deferred until the kernel
+ * has released the buffers, typically when the peer acknowledged the data.
+ * The callbacks of later writes and of uv_shutdown() wait for them, so they
+ * still run in order.
+ * Pinning the pages has a fixed cost that only pays off for large writes,
+ * smaller ones are copied as usual; 10 KiB is a reasonable threshold.
+ * Closing the handle before then completes those writes with UV_ECANCELED
+ * even though the data went out: the kernel may still read from the buffers
+ * until the peer acknowledged it or the connection is torn down, so keep
+ * the memory valid and unchanged for that long.
+ * Linux 4.14 and up, UV_ENOTSUP elsewhere.
+ */
+UV_EXTERN int uv_tcp_zerocopy(uv_tcp_t* handle, int enable, size_t threshold);
+
+/*
+ * Limit the data that the kernel accepts from the write queue to `bytes`
+ * more than what it hasn't sent yet (TCP_NOTSENT_LOWAT). Everything else
+ * stays in the write queue, where write_queue_size and the watermarks of
+ * uv_stream_set_watermarks() account for it, instead of sitting unnoticed in
+ * a send buffer that can grow to several megabytes. 0 restores the system
+ * default. Linux 3.12 and up and OS X, UV_ENOTSUP elsewhere.
+ */
+UV_EXTERN int uv_tcp_notsent_lowat(uv_tcp_t* handle, unsigned int bytes);
+
 enum uv_tcp_flags {
   /* Used with uv_tcp_bind, when an IPv6 address is used. */
-  UV_TCP_IPV6ONLY = 1
+  UV_TCP_IPV6ONLY = 1,
+  /*
+   * Used with uv_tcp_bind. Sets SO_REUSEPORT so that several handles, usually
+   * one per loop and thread, can bind and listen on the same address. The
+   * kernel spreads incoming connections across them. Linux 3.9 and up (and
+   * SO_REUSEPORT_LB on FreeBSD), UV_ENOTSUP elsewhere.
+   */
+  UV_TCP_REUSEPORT = 2,
+  /*
+   * Like UV_TCP_REUSEPORT but hands each connection to the handle whose
+   * position in the group, i.e. the order the handles were bound in, matches
+   * the CPU that received it. Bind one handle per CPU from threads pinned to
+   * those CPUs. Linux 4.6 and up, UV_ENOTSUP elsewhere.
+   */
+  UV_TCP_REUSEPORT_CPU = 4
 };
 
 /*
@@ -880,6 +1156,42 @@ struct uv_connect_s {
   UV_CONNECT_PRIVATE_FIELDS
 };
 
+/*
+ * Resolve `node` and `service` with getaddrinfo(3) and connect to whichever
+ * address answers first (RFC 8305, "Happy Eyeballs"). Attempts alternate
+ * between IPv6 and IPv4, starting with the family the resolver ranked first.
+ * A new attempt is started every `delay` milliseconds, or as soon as the
+ * previous one fails, while the earlier ones keep running. 0 selects the
+ * default of 250 ms.
+ *
+ * `handle` must be an initialized TCP handle that is not bound or connected
+ * yet. The first attempt to complete its handshake becomes the handle's
+ * socket, the others are aborted. `req->addr` then holds the address it
+ * connected to.
+ *
+ * The callback is made with status 0 on success, an UV_EAI_* error when
+ * resolution failed, the error of the last attempt when none succeeded, or
+ * UV_ECANCELED when the handle was closed first.
+ *
+ * Not supported on Windows, returns UV_ENOTSUP.
+ */
+UV_EXTERN int uv_tcp_connect_host(uv_connect_host_t* req,
+                                  uv_tcp_t* handle,
+                                  const char* node,
+                                  const char* service,
+                                  unsigned int delay,
+                                  uv_connect_host_cb cb);
+
+/* uv_connect_host_t is a subclass of uv_req_t. */
+struct uv_connect_host_s {
+  UV_REQ_FIELDS
+  uv_connect_host_cb cb;
+  uv_tcp_t* handle;
+  /* read-only, the winning address when the status is 0 */
+  struct sockaddr_storage addr;
+  UV_CONNECT_HOST_PRIVATE_FIELDS
+};
+
 
 /*
  * UDP support.
@@ -901,7 +1213,32 @@ enum uv_udp_flags {
    * (provided they all set the flag) but only the last one to bind will receive
    * any traffic, in effect "stealing" the port from the previous listener.
    */
-  UV_UDP_REUSEADDR = 4
+  UV_UDP_REUSEADDR = 4,
+  /*
+   * Linux only, ignored elsewhere. Receive datagrams in batches with
+   * recvmmsg(2) into buffers owned by the event loop instead of calling the
+   * alloc callback once for every datagram. Used in uv_udp_bind().
+   */
+  UV_UDP_RECVMMSG = 8,
+  /*
+   * Indicates that the buffer passed to uv_udp_recv_cb belongs to the event
+   * loop and was not obtained from the alloc callback. Do not free it; it is
+   * only valid for the duration of the callback.
+   */
+  UV_UDP_MMSG_CHUNK = 16,
+  /*
+   * Sets SO_REUSEPORT so that several handles, usually one per loop and
+   * thread, can bind to the same address. Unlike UV_UDP_REUSEADDR, the kernel
+   * spreads incoming datagrams across all of them. Linux 3.9 and up (and
+   * SO_REUSEPORT_LB on FreeBSD), UV_ENOTSUP elsewhere. Used in uv_udp_bind().
+   */
+  UV_UDP_REUSEPORT = 32,
+  /*
+   * Like UV_UDP_REUSEPORT but hands each datagram to the handle whose
+   * position in the group matches the CPU that received it, see
+   * UV_TCP_REUSEPORT_CPU. Linux 4.6 and up. Used in uv_udp_bind().
+   */
+  UV_UDP_REUSEPORT_CPU = 64
 };
 
 /*
@@ -922,12 +1259,17 @@ typedef void (*uv_udp_send_cb)(uv_udp_send_t* req, int status);
  *  addr    struct sockaddr* containing the address of the sender. Can be NULL.
  *          Valid for the duration of the callback only.
  *  flags   One or more OR'ed UV_UDP_* constants. Right now only UV_UDP_PARTIAL
- *          is used.
+ *          and UV_UDP_MMSG_CHUNK are used.
  *
  * NOTE:
  *  The receive callback will be called with nread == 0 and addr == NULL when
  *  there is nothing to read, and with nread == 0 and addr != NULL when an empty
  *  UDP packet is received.
+ *
+ *  When the handle was bound with UV_UDP_RECVMMSG, datagrams are delivered
+ *  in a loop from a single recvmmsg(2) call with UV_UDP_MMSG_CHUNK set in
+ *  `flags`; the alloc callback is not called and `buf` must not be freed.
+ *  The "nothing to read" callback then carries an empty `buf`.
  */
 typedef void (*uv_udp_recv_cb)(uv_udp_t* handle,
                                ssize_t nread,
@@ -948,6 +1290,16 @@ struct uv_udp_s {
    * Number of send requests currently in the queue awaiting to be processed.
    */
   size_t send_queue_count;
+  /*
+   * Number of datagrams returned by the most recent recvmmsg() call. Only
+   * updated for handles bound with UV_UDP_RECVMMSG.
+   */
+  unsigned int recv_mmsg_count;
+  /*
+   * Size of the segments that make up the buffer passed to the receive
+   * callback when UDP GRO coalesced it, 0 otherwise. See uv_udp_set_gro().
+   */
+  unsigned int recv_segment_size;
   UV_UDP_PRIVATE_FIELDS
 };
 
@@ -991,8 +1343,9 @@ UV_EXTERN int uv_udp_open(uv_udp_t* handle, uv_os_sock_t sock);
  *  handle    UDP handle. Should have been initialized with uv_udp_init().
  *  addr      struct sockaddr_in or struct sockaddr_in6 with the address and
  *            port to bind to.
- *  flags     Indicate how the socket will be bound, UV_UDP_IPV6ONLY and
- *            UV_UDP_REUSEADDR are supported.
+ *  flags     Indicate how the socket will be bound, UV_UDP_IPV6ONLY,
+ *            UV_UDP_REUSEADDR, UV_UDP_REUSEPORT, UV_UDP_REUSEPORT_CPU and
+ *            UV_UDP_RECVMMSG are supported.
  *
  * Returns:
  *  0 on success, or an error code < 0 on failure.
@@ -1078,6 +1431,23 @@ UV_EXTERN int uv_udp_set_multicast_interface(uv_udp_t* handle,
  */
 UV_EXTERN int uv_udp_set_broadcast(uv_udp_t* handle, int on);
 
+/*
+ * Turn UDP generic receive offload on or off. With GRO on, the kernel may
+ * coalesce consecutive datagrams from the same flow into one buffer; the
+ * receive callback then finds the size of the original datagrams in
+ * `handle->recv_segment_size`. Only the last segment can be shorter.
+ *
+ * Arguments:
+ *  handle              UDP handle. Should have been initialized with
+ *                      uv_udp_init() and bound.
+ *  on                  1 for on, 0 for off.
+ *
+ * Returns:
+ *  0 on success, or an error code < 0 on failure. UV_ENOTSUP or
+ *  UV_ENOPROTOOPT when the platform or kernel doesn't support GRO.
+ */
+UV_EXTERN int uv_udp_set_gro(uv_udp_t* handle, int on);
+
 /*
  * Set the time to live.
  *
@@ -1114,6 +1484,25 @@ UV_EXTERN int uv_udp_send(uv_udp_send_t* req,
                           const struct sockaddr* addr,
                           uv_udp_send_cb send_cb);
 
+/*
+ * Same as uv_udp_send(), but lets the kernel split the data into datagrams
+ * of `segment_size` bytes each (UDP generic segmentation offload). Only the
+ * last datagram can be shorter. Saves a trip through the network stack per
+ * datagram when sending a large buffer as a stream of MTU-sized packets.
+ *
+ * Returns:
+ *  0 on success, or an error code < 0 on failure. UV_ENOTSUP when the
+ *  platform doesn't support segmentation offload; kernels without support
+ *  report an error through `send_cb`.
+ */
+UV_EXTERN int uv_udp_send_segmented(uv_udp_send_t* req,
+                                    uv_udp_t* handle,
+                                    const uv_buf_t bufs[],
+                                    unsigned int nbufs,
+                                    const struct sockaddr* addr,
+                                    unsigned int segment_size,
+                                    uv_udp_send_cb send_cb);
+
 /*
  * Same as uv_udp_send(), but won't queue a send request if it can't be completed
  * immediately.
@@ -1719,6 +2108,131 @@ UV_EXTERN int uv_process_kill(uv_process_t*, int signum);
 UV_EXTERN int uv_kill(int pid, int signum);
 
 
+/*
+ * Cluster support.
+ *
+ * A master process owns a listening TCP socket and spawns worker processes
+ * that serve its connections, which lets a single-threaded program use more
+ * than one core. Every worker is connected to the master by an IPC channel
+ * on its file descriptor UV_CLUSTER_FD.
+ */
+#define UV_CLUSTER_FD 3
+
+typedef enum {
+  /*
+   * The master accepts connections and hands them to the workers in turn.
+   * Connections accepted in one loop iteration are passed in batches, one
+   * message per worker.
+   */
+  UV_CLUSTER_ROUND_ROBIN,
+  /*
+   * Like UV_CLUSTER_ROUND_ROBIN but every connection goes to the worker with
+   * the fewest open connections. Workers report closed connections with
+   * uv_cluster_done().
+   */
+  UV_CLUSTER_LEAST_LOAD,
+  /*
+   * The workers get the listen socket and accept connections themselves. On
+   * Linux every connection only wakes up one of them, see
+   * uv_tcp_exclusive_accept().
+   */
+  UV_CLUSTER_SHARED
+} uv_cluster_mode;
+
+typedef void (*uv_cluster_exit_cb)(uv_cluster_t* cluster,
+                                   int pid,
+                                   int64_t exit_status,
+                                   int term_signal);
+typedef void (*uv_cluster_close_cb)(uv_cluster_t* cluster);
+typedef void (*uv_cluster_connection_cb)(uv_cluster_worker_t* worker,
+                                         int status);
+
+struct uv_cluster_s {
+  void* data;
+  /* read-only */
+  uv_loop_t* loop;
+  uv_cluster_mode mode;
+  unsigned int nworkers;
+  /* Bind it with uv_tcp_bind() before calling uv_cluster_listen(). */
+  uv_tcp_t server;
+  UV_CLUSTER_PRIVATE_FIELDS
+};
+
+/*
+ * Initializes the master side of a cluster. `exit_cb` is called when a
+ * worker exits, it may be NULL.
+ */
+UV_EXTERN int uv_cluster_init(uv_loop_t* loop,
+                              uv_cluster_t* cluster,
+                              uv_cluster_mode mode,
+                              uv_cluster_exit_cb exit_cb);
+
+/*
+ * Spawns a worker process like uv_spawn() does, with the IPC channel as its
+ * file descriptor UV_CLUSTER_FD. `options->stdio` must leave that slot
+ * unused. `options->exit_cb` is ignored, the cluster's exit callback is used
+ * instead. Workers can be added at any time.
+ */
+UV_EXTERN int uv_cluster_spawn(uv_cluster_t* cluster,
+                               const uv_process_options_t* options);
+
+/*
+ * Starts listening on `cluster->server` and handing out connections to the
+ * workers, or the listen socket in UV_CLUSTER_SHARED mode.
+ */
+UV_EXTERN int uv_cluster_listen(uv_cluster_t* cluster, int backlog);
+
+/*
+ * Sends `signum` to all workers. Returns the first error, if any.
+ */
+UV_EXTERN int uv_cluster_kill(uv_cluster_t* cluster, int signum);
+
+/*
+ * Closes the listen socket and the IPC channels. Workers see UV_EOF and are
+ * expected to exit. `close_cb` is called once the last one has.
+ */
+UV_EXTERN void uv_cluster_close(uv_cluster_t* cluster,
+                                uv_cluster_close_cb close_cb);
+
+struct uv_cluster_worker_s {
+  void* data;
+  /* read-only */
+  uv_loop_t* loop;
+  uv_pipe_t ipc;
+  uv_tcp_t server;
+  uv_cluster_connection_cb connection_cb;
+  UV_CLUSTER_WORKER_PRIVATE_FIELDS
+};
+
+/*
+ * Initializes the worker side of a cluster, in a process started with
+ * uv_cluster_spawn(). `connection_cb` is called like a uv_connection_cb for
+ * every new connection, call uv_cluster_accept() from it. It's called with
+ * UV_EOF when the master went away.
+ */
+UV_EXTERN int uv_cluster_worker_init(uv_loop_t* loop,
+                                     uv_cluster_worker_t* worker,
+                                     uv_cluster_connection_cb connection_cb);
+
+/*
+ * Accepts the connection that `connection_cb` was called for into `client`,
+ * an initialized uv_tcp_t.
+ */
+UV_EXTERN int uv_cluster_accept(uv_cluster_worker_t* worker,
+                                uv_stream_t* client);
+
+/*
+ * Tells the master that a connection was closed. Only needed in
+ * UV_CLUSTER_LEAST_LOAD mode, reports are coalesced.
+ */
+UV_EXTERN int uv_cluster_done(uv_cluster_worker_t* worker);
+
+/*
+ * Closes the IPC channel and the shared listen socket, if any.
+ */
+UV_EXTERN void uv_cluster_worker_close(uv_cluster_worker_t* worker);
+
+
 /*
  * uv_work_t is a subclass of uv_req_t.
  */
@@ -1730,12 +2244,85 @@ struct uv_work_s {
   UV_WORK_PRIVATE_FIELDS
 };
 
+/*
+ * Classes of thread pool work, in scheduling order. Every class has its own
+ * queue and a cap on the number of threads it may occupy at the same time so
+ * that, for example, a burst of DNS lookups can't hold up file reads.
+ *
+ *  UV_WORK_FAST_IO   File system operations. Not capped.
+ *  UV_WORK_SLOW_IO   DNS lookups, fsync and sendfile. At most half the pool.
+ *  UV_WORK_CPU       Compute-bound work. Leaves one thread for I/O.
+ *  UV_WORK_USER      uv_queue_work(). Not capped.
+ */
+typedef enum {
+  UV_WORK_FAST_IO,
+  UV_WORK_SLOW_IO,
+  UV_WORK_CPU,
+  UV_WORK_USER
+} uv_work_class;
+
 /* Queues a work request to execute asynchronously on the thread pool. */
 UV_EXTERN int uv_queue_work(uv_loop_t* loop,
                             uv_work_t* req,
                             uv_work_cb work_cb,
                             uv_after_work_cb after_work_cb);
 
+/* Same as uv_queue_work(), but runs the work in class `cls`. On Windows the
+ * class is ignored.
+ */
+UV_EXTERN int uv_queue_work_class(uv_loop_t* loop,
+                                  uv_work_t* req,
+                                  uv_work_class cls,
+                                  uv_work_cb work_cb,
+                                  uv_after_work_cb after_work_cb);
+
+/*
+ * Batches thread pool submissions on `loop`. Requests submitted between
+ * uv_work_batch_begin() and the matching uv_work_batch_end(), with
+ * uv_queue_work() or the asynchronous uv_fs_* and DNS functions, are held
+ * back and handed to the pool together when the batch ends: they are spread
+ * over the idle threads and every thread is woken at most once. Calls nest,
+ * the outermost uv_work_batch_end() submits the batch.
+ *
+ * Requests in a batch that hasn't ended yet can be cancelled. They are not
+ * picked up before the batch ends, so don't keep one open across loop
+ * iterations.
+ *
+ * On Windows, batching has no effect.
+ */
+UV_EXTERN void uv_work_batch_begin(uv_loop_t* loop);
+UV_EXTERN void uv_work_batch_end(uv_loop_t* loop);
+
+/*
+ * Queues the `nreqs` work requests in `reqs` as one batch, see
+ * uv_work_batch_begin(). All requests run `work_cb` in class `cls` and
+ * complete with `after_work_cb`.
+ *
+ * Returns 0 on success, UV_EINVAL if `work_cb` is NULL or `cls` is not a
+ * valid work class.
+ */
+UV_EXTERN int uv_queue_work_batch(uv_loop_t* loop,
+                                  uv_work_t* reqs[],
+                                  unsigned int nreqs,
+                                  uv_work_class cls,
+                                  uv_work_cb work_cb,
+                                  uv_after_work_cb after_work_cb);
+
+/*
+ * Sets the bounds on the size of the thread pool. Threads are started when
+ * work is submitted and no worker is idle, up to `max`, and threads
+ * above `min` exit after being idle for a while. Surplus threads exit when
+ * they run out of work after `max` is lowered.
+ *
+ * The defaults are a minimum of 1 and a maximum of 4, or the value of the
+ * UV_THREADPOOL_SIZE environment variable. `max` is capped at 128.
+ *
+ * Returns 0 on success, UV_EINVAL if the bounds are invalid. This function is
+ * currently only implemented on Unix platforms. On Windows, it always returns
+ * UV_ENOSYS.
+ */
+UV_EXTERN int uv_threadpool_set_limits(unsigned int min, unsigned int max);
+
 /* Cancel a pending request. Fails if the request is executing or has finished
  * executing.
  *
@@ -1864,6 +2451,12 @@ UV_EXTERN void uv_free_interface_addresses(uv_interface_address_t* addresses,
  * call will be called synchronously. req should be a pointer to an
  * uninitialized uv_fs_t object.
  *
+ * On Linux 5.6 and newer, uv_fs_open, uv_fs_close, uv_fs_read, uv_fs_write,
+ * uv_fs_fsync, uv_fs_fdatasync, uv_fs_stat, uv_fs_lstat and uv_fs_fstat are
+ * submitted to an io_uring owned by the loop instead of the thread pool. Such
+ * requests can't be cancelled with uv_cancel(). Set the UV_USE_IO_URING
+ * environment variable to 0 to always use the thread pool.
+ *
  * uv_fs_req_cleanup() must be called after completion of the uv_fs_
  * function to free any internal memory allocations associated with the
  * request.
@@ -2021,6 +2614,61 @@ UV_EXTERN int uv_fs_fchown(uv_loop_t* loop, uv_fs_t* req, uv_file file,
     uv_uid_t uid, uv_gid_t gid, uv_fs_cb cb);
 
 
+/*
+ * Thread pool statistics, see uv_threadpool_stats().
+ *
+ * Statistics are kept per request type. File system requests are indexed by
+ * their uv_fs_type, the other request types by the constants below.
+ */
+enum {
+  UV_THREADPOOL_STATS_GETADDRINFO = UV_FS_FCHOWN + 1,
+  UV_THREADPOOL_STATS_GETNAMEINFO,
+  UV_THREADPOOL_STATS_WORK,
+  UV_THREADPOOL_STATS_TYPES
+};
+
+/*
+ * Histogram bucket 0 counts durations under 1 microsecond, bucket n counts
+ * durations from 2^(n-1) up to 2^n microseconds. The last bucket is open
+ * ended.
+ */
+#define UV_THREADPOOL_STATS_BUCKETS 24
+
+/*
+ * All counters are unsigned and wrap around; compute deltas between
+ * snapshots.
+ */
+typedef struct {
+  unsigned int submitted;
+  unsigned int completed;
+  unsigned int cancelled;
+  unsigned int queued;  /* Waiting for a worker right now. */
+  unsigned int wait_time[UV_THREADPOOL_STATS_BUCKETS];
+  unsigned int run_time[UV_THREADPOOL_STATS_BUCKETS];
+} uv_threadpool_type_stats_t;
+
+typedef struct {
+  unsigned int threads;       /* Thread pool wide, also for loop snapshots. */
+  unsigned int idle_threads;
+  uv_threadpool_type_stats_t types[UV_THREADPOOL_STATS_TYPES];
+} uv_threadpool_stats_t;
+
+/*
+ * Copies the thread pool statistics of `loop` into `stats`. Pass NULL for
+ * `loop` to get the totals of all loops that collect statistics.
+ *
+ * Collection is switched on per loop with uv_loop_configure() and the
+ * UV_LOOP_THREADPOOL_STATS option. Counters are updated with atomic
+ * operations and read without locking, so a snapshot is cheap but not
+ * necessarily consistent across counters.
+ *
+ * Returns 0 on success, UV_ENOENT if `loop` doesn't collect statistics.
+ * This function is currently only implemented on Unix platforms. On Windows,
+ * it always returns UV_ENOSYS.
+ */
+UV_EXTERN int uv_threadpool_stats(uv_loop_t* loop, uv_threadpool_stats_t* stats);
+
+
 enum uv_fs_event {
   UV_RENAME = 1,
   UV_CHANGE = 2
@@ -174,6 +174,8 @@ static void init_once(void) {
 
 void uv__work_submit(uv_loop_t* loop,
                      struct uv__work* w,
+                     uv_work_class cls,
+                     unsigned int type,
                      void (*work)(struct uv__work* w),
                      void (*done)(struct uv__work* w, int status)) {
   uv_once(&once, init_once);
@@ -269,7 +271,12 @@ int uv_queue_work(uv_loop_t* loop,
   req->loop = loop;
   req->work_cb = work_cb;
   req->after_work_cb = after_work_cb;
-  uv__work_submit(loop, &req->work_req, uv__queue_work, uv__queue_done);
+  uv__work_submit(loop,
+                  &req->work_req,
+                  UV_WORK_USER,
+                  UV_THREADPOOL_STATS_WORK,
+                  uv__queue_work,
+                  uv__queue_done);
   return 0;
 }
 
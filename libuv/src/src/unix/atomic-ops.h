@@ -20,6 +20,8 @@
 
 UV_UNUSED(static int cmpxchgi(int* ptr, int oldval, int newval));
 UV_UNUSED(static long cmpxchgl(long* ptr, long oldval, long newval));
+UV_UNUSED(static void* cmpxchgp(void** ptr, void* oldval, void* newval));
+UV_UNUSED(static int xaddi(int* ptr, int val));
 UV_UNUSED(static void cpu_relax(void));
 
 /* Prefer hand-rolled assembly over the gcc builtins because the latter also
@@ -51,6 +53,32 @@ UV_UNUSED(static long cmpxchgl(long* ptr, long oldval, long newval)) {
 #endif
 }
 
+UV_UNUSED(static void* cmpxchgp(void** ptr, void* oldval, void* newval)) {
+#if defined(__i386__) || defined(__x86_64__)
+  void* out;
+  __asm__ __volatile__ ("lock; cmpxchg %2, %1;"
+                        : "=a" (out), "+m" (*(void* volatile*) ptr)
+                        : "r" (newval), "0" (oldval)
+                        : "memory");
+  return out;
+#else
+  return __sync_val_compare_and_swap(ptr, oldval, newval);
+#endif
+}
+
+/* Returns the old value. */
+UV_UNUSED(static int xaddi(int* ptr, int val)) {
+#if defined(__i386__) || defined(__x86_64__)
+  __asm__ __volatile__ ("lock; xadd %0, %1;"
+                        : "+r" (val), "+m" (*(volatile int*) ptr)
+                        :
+                        : "memory");
+  return val;
+#else
+  return __sync_fetch_and_add(ptr, val);
+#endif
+}
+
 UV_UNUSED(static void cpu_relax(void)) {
 #if defined(__i386__) || defined(__x86_64__)
   __asm__ __volatile__ ("rep; nop");  /* a.k.a. PAUSE */
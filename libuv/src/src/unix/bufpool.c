@@ -0,0 +1,177 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/* Loop-owned read buffers, see UV_LOOP_READ_BUFFER_POOL.
+ *
+ * Every buffer is a chunk with a small header in front of the data. The
+ * header records the size class and whether the read callback retained the
+ * buffer. Free chunks are kept on one list per size class, up to
+ * UV__READ_POOL_KEEP of them. Chunks beyond that go back to the allocator.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#define UV__READ_POOL_KEEP 16
+
+union uv__read_chunk {
+  struct {
+    union uv__read_chunk* next;
+    unsigned int size_class;
+    unsigned int retained;
+  } s;
+  double align;  /* Keeps the data that follows the header aligned. */
+};
+
+struct uv__read_pool {
+  union uv__read_chunk* free[UV__READ_POOL_CLASSES];
+  unsigned int nfree[UV__READ_POOL_CLASSES];
+};
+
+static const size_t uv__read_pool_sizes[UV__READ_POOL_CLASSES] = {
+  4 * 1024,
+  16 * 1024,
+  64 * 1024
+};
+
+
+static union uv__read_chunk* uv__read_chunk(const uv_buf_t* buf) {
+  return (union uv__read_chunk*) buf->base - 1;
+}
+
+
+int uv__read_pool_enabled(const uv_loop_t* loop) {
+  return loop->read_pool != NULL;
+}
+
+
+int uv__read_pool_init(uv_loop_t* loop) {
+  struct uv__read_pool* pool;
+
+  if (loop->read_pool != NULL)
+    return 0;
+
+  pool = calloc(1, sizeof(*pool));
+  if (pool == NULL)
+    return -ENOMEM;
+
+  loop->read_pool = pool;
+  return 0;
+}
+
+
+void uv__read_pool_close(uv_loop_t* loop) {
+  struct uv__read_pool* pool;
+  union uv__read_chunk* chunk;
+  unsigned int i;
+
+  pool = loop->read_pool;
+  if (pool == NULL)
+    return;
+
+  for (i = 0; i < UV__READ_POOL_CLASSES; i++) {
+    while (pool->free[i] != NULL) {
+      chunk = pool->free[i];
+      pool->free[i] = chunk->s.next;
+      free(chunk);
+    }
+  }
+
+  free(pool);
+  loop->read_pool = NULL;
+}
+
+
+int uv__read_pool_get(uv_loop_t* loop, unsigned int size_class, uv_buf_t* buf) {
+  struct uv__read_pool* pool;
+  union uv__read_chunk* chunk;
+  size_t size;
+
+  pool = loop->read_pool;
+  assert(pool != NULL);
+  assert(size_class < UV__READ_POOL_CLASSES);
+
+  size = uv__read_pool_sizes[size_class];
+  chunk = pool->free[size_class];
+
+  if (chunk != NULL) {
+    pool->free[size_class] = chunk->s.next;
+    pool->nfree[size_class]--;
+  } else {
+    chunk = malloc(sizeof(*chunk) + size);
+    if (chunk == NULL)
+      return -ENOMEM;
+    chunk->s.size_class = size_class;
+  }
+
+  chunk->s.next = NULL;
+  chunk->s.retained = 0;
+  buf->base = (char*) (chunk + 1);
+  buf->len = size;
+
+  return 0;
+}
+
+
+static void uv__read_pool_free(uv_loop_t* loop, union uv__read_chunk* chunk) {
+  struct uv__read_pool* pool;
+  unsigned int size_class;
+
+  pool = loop->read_pool;
+  size_class = chunk->s.size_class;
+
+  if (pool == NULL || pool->nfree[size_class] == UV__READ_POOL_KEEP) {
+    free(chunk);
+    return;
+  }
+
+  chunk->s.next = pool->free[size_class];
+  pool->free[size_class] = chunk;
+  pool->nfree[size_class]++;
+}
+
+
+void uv__read_pool_put(uv_loop_t* loop, const uv_buf_t* buf) {
+  union uv__read_chunk* chunk;
+
+  chunk = uv__read_chunk(buf);
+  if (chunk->s.retained == 0)
+    uv__read_pool_free(loop, chunk);
+}
+
+
+void uv_buf_retain(const uv_buf_t* buf) {
+  uv__read_chunk(buf)->s.retained = 1;
+}
+
+
+void uv_buf_release(uv_loop_t* loop, const uv_buf_t* buf) {
+  union uv__read_chunk* chunk;
+
+  chunk = uv__read_chunk(buf);
+  assert(chunk->s.retained == 1);
+  uv__read_pool_free(loop, chunk);
+}
@@ -0,0 +1,738 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Master/worker process clusters.
+ *
+ * The master end of a worker's IPC channel is a plain socket with its own
+ * watcher rather than a uv_pipe_t: the master sends several file descriptors
+ * per message, which uv_write2() can't, and only ever reads load reports.
+ * The worker end is an IPC uv_pipe_t, uv__stream_recv_cmsg() already queues
+ * all file descriptors of a message.
+ *
+ * Every byte on the channel is a message. From master to worker, it's 'c' for
+ * an accepted connection or 'l' for the listen socket, and carries one file
+ * descriptor, in order. From worker to master, 'd' reports a closed
+ * connection.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+/* Matches UV__CMSG_FD_COUNT, what the worker's recvmsg() takes at once. */
+#define UV__CLUSTER_BATCH 64
+
+/* Connections accepted per wakeup, the rest waits for the next iteration. */
+#define UV__CLUSTER_ACCEPT_MAX 256
+
+#define UV__CLUSTER_CONNECTION 'c'
+#define UV__CLUSTER_LISTEN     'l'
+#define UV__CLUSTER_DONE       'd'
+
+/* uv_cluster_t flags */
+enum {
+  UV__CLUSTER_LISTENING = 1,
+  UV__CLUSTER_CLOSING   = 2,
+  UV__CLUSTER_CLOSED    = 4,  /* The server handle is closed. */
+  UV__CLUSTER_EMFILE    = 8   /* Not accepting until descriptors free up. */
+};
+
+/* uv_cluster_worker_t flags */
+enum {
+  UV__CLUSTER_WORKER_SHARED  = 1,  /* Got the listen socket. */
+  UV__CLUSTER_WORKER_WRITING = 2   /* done_req is in flight. */
+};
+
+struct uv__cluster_worker {
+  uv_process_t process;
+  uv__io_t io;  /* Master end of the IPC channel. */
+  uv_cluster_t* cluster;
+  void* queue[2];
+  int* fds;  /* Accepted connections that wait to be sent. */
+  unsigned int nfds;
+  unsigned int size;
+  unsigned int load;  /* Connections the worker has open. */
+  int send_listen;
+};
+
+
+static struct uv__cluster_worker* uv__cluster_pick(uv_cluster_t* cluster) {
+  struct uv__cluster_worker* worker;
+  struct uv__cluster_worker* best;
+  QUEUE* head;
+  QUEUE* q;
+  unsigned int i;
+
+  head = (QUEUE*) &cluster->workers;
+  best = NULL;
+
+  if (cluster->mode == UV_CLUSTER_LEAST_LOAD) {
+    QUEUE_FOREACH(q, head) {
+      worker = QUEUE_DATA(q, struct uv__cluster_worker, queue);
+      if (worker->io.fd == -1)
+        continue;
+      if (best == NULL || worker->load + worker->nfds < best->load + best->nfds)
+        best = worker;
+    }
+
+    return best;
+  }
+
+  q = cluster->next_worker;
+  for (i = 0; i <= cluster->nworkers; i++) {
+    if (q == head) {
+      q = QUEUE_NEXT(q);
+      continue;
+    }
+
+    worker = QUEUE_DATA(q, struct uv__cluster_worker, queue);
+    q = QUEUE_NEXT(q);
+    if (worker->io.fd != -1) {
+      cluster->next_worker = q;
+      return worker;
+    }
+  }
+
+  return NULL;
+}
+
+
+/* Accepts again after uv__cluster_accept_io() ran out of file descriptors,
+ * once queued connections were sent or a worker's channel was closed.
+ */
+static void uv__cluster_accept_resume(uv_cluster_t* cluster) {
+  if (!(cluster->flags & UV__CLUSTER_EMFILE))
+    return;
+
+  cluster->flags &= ~UV__CLUSTER_EMFILE;
+  if (!(cluster->flags & UV__CLUSTER_CLOSING))
+    uv__io_start(cluster->loop, &cluster->server.io_watcher, UV__POLLIN);
+}
+
+
+static void uv__cluster_channel_close(struct uv__cluster_worker* worker) {
+  uv_loop_t* loop;
+
+  if (worker->io.fd == -1)
+    return;
+
+  loop = worker->cluster->loop;
+  uv__io_close(loop, &worker->io);
+  uv__close(worker->io.fd);
+  worker->io.fd = -1;
+
+  uv__cluster_accept_resume(worker->cluster);
+
+  while (worker->nfds > 0)
+    uv__close(worker->fds[--worker->nfds]);
+
+  free(worker->fds);
+  worker->fds = NULL;
+  worker->size = 0;
+  worker->load = 0;
+}
+
+
+static int uv__cluster_queue_fd(struct uv__cluster_worker* worker, int fd) {
+  unsigned int size;
+  int* fds;
+
+  if (worker->nfds == worker->size) {
+    size = worker->size + UV__CLUSTER_BATCH;
+    fds = realloc(worker->fds, size * sizeof(*fds));
+    if (fds == NULL)
+      return -ENOMEM;
+    worker->fds = fds;
+    worker->size = size;
+  }
+
+  worker->fds[worker->nfds++] = fd;
+  return 0;
+}
+
+
+/* Sends the queued file descriptors, up to UV__CLUSTER_BATCH per sendmsg(). */
+static void uv__cluster_flush(struct uv__cluster_worker* worker) {
+  union {
+    char data[CMSG_SPACE(UV__CLUSTER_BATCH * sizeof(int))];
+    struct cmsghdr alias;
+  } scratch;
+  char tags[UV__CLUSTER_BATCH];
+  struct cmsghdr* cmsg;
+  struct msghdr msg;
+  struct iovec iov;
+  uv_cluster_t* cluster;
+  unsigned int n;
+  unsigned int i;
+  ssize_t r;
+  int* fds;
+  int fd;
+
+  cluster = worker->cluster;
+
+  while (worker->io.fd != -1 && (worker->send_listen || worker->nfds > 0)) {
+    if (worker->send_listen) {
+      fd = uv__stream_fd(&cluster->server);
+      fds = &fd;
+      n = 1;
+      tags[0] = UV__CLUSTER_LISTEN;
+    } else {
+      fds = worker->fds;
+      n = worker->nfds;
+      if (n > UV__CLUSTER_BATCH)
+        n = UV__CLUSTER_BATCH;
+      memset(tags, UV__CLUSTER_CONNECTION, n);
+    }
+
+    iov.iov_base = tags;
+    iov.iov_len = n;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = scratch.data;
+    msg.msg_controllen = CMSG_SPACE(n * sizeof(int));
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(n * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, n * sizeof(int));
+
+    /* A message this small goes out whole or not at all. */
+    do
+      r = sendmsg(worker->io.fd, &msg, 0);
+    while (r == -1 && errno == EINTR);
+
+    if (r == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        uv__io_start(cluster->loop, &worker->io, UV__POLLOUT);
+        return;
+      }
+
+      /* The worker is gone, its exit callback cleans up. */
+      uv__cluster_channel_close(worker);
+      return;
+    }
+
+    assert((size_t) r == n);
+
+    if (worker->send_listen) {
+      worker->send_listen = 0;
+      continue;
+    }
+
+    for (i = 0; i < n; i++)
+      uv__close(worker->fds[i]);
+
+    uv__cluster_accept_resume(cluster);
+    worker->load += n;
+    worker->nfds -= n;
+    memmove(worker->fds, worker->fds + n, worker->nfds * sizeof(int));
+  }
+
+  if (worker->io.fd != -1)
+    uv__io_stop(cluster->loop, &worker->io, UV__POLLOUT);
+}
+
+
+static void uv__cluster_channel_io(uv_loop_t* loop,
+                                   uv__io_t* w,
+                                   unsigned int events) {
+  struct uv__cluster_worker* worker;
+  char buf[UV__CLUSTER_BATCH];
+  ssize_t n;
+  ssize_t i;
+
+  worker = container_of(w, struct uv__cluster_worker, io);
+
+  if (events & UV__POLLOUT)
+    uv__cluster_flush(worker);
+
+  if (!(events & (UV__POLLIN | UV__POLLERR | UV__POLLHUP)))
+    return;
+
+  while (worker->io.fd != -1) {
+    do
+      n = read(worker->io.fd, buf, sizeof(buf));
+    while (n == -1 && errno == EINTR);
+
+    if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      uv__io_drained(w, UV__POLLIN);
+      return;
+    }
+
+    if (n <= 0) {
+      uv__cluster_channel_close(worker);
+      return;
+    }
+
+    for (i = 0; i < n; i++)
+      if (buf[i] == UV__CLUSTER_DONE && worker->load > 0)
+        worker->load--;
+  }
+}
+
+
+static void uv__cluster_accept_io(uv_loop_t* loop,
+                                  uv__io_t* w,
+                                  unsigned int events) {
+  struct uv__cluster_worker* worker;
+  uv_cluster_t* cluster;
+  unsigned int n;
+  QUEUE* q;
+  int fd;
+
+  cluster = container_of(w, uv_cluster_t, server.io_watcher);
+
+  for (n = 0; n < UV__CLUSTER_ACCEPT_MAX; n++) {
+    worker = uv__cluster_pick(cluster);
+    if (worker == NULL) {
+      /* Leave connections in the backlog until a worker is spawned. */
+      uv__io_stop(loop, w, UV__POLLIN);
+      break;
+    }
+
+    fd = uv__accept(w->fd);
+    if (fd < 0) {
+      if (fd == -ECONNABORTED)
+        continue;
+
+      /* Drop the backlog like uv__server_io() does. Without the reserve file
+       * descriptor for that, wait until queued connections are handed out,
+       * POLLIN would only wake us up again right away.
+       */
+      if (fd == -EMFILE || fd == -ENFILE) {
+        fd = uv__emfile_trick(loop, w->fd);
+        if (fd != -EAGAIN && fd != -EWOULDBLOCK) {
+          cluster->flags |= UV__CLUSTER_EMFILE;
+          uv__io_stop(loop, w, UV__POLLIN);
+        }
+      }
+
+      if (fd == -EAGAIN || fd == -EWOULDBLOCK)
+        uv__io_drained(w, UV__POLLIN);
+
+      break;
+    }
+
+    if (uv__cluster_queue_fd(worker, fd))
+      uv__close(fd);
+  }
+
+  /* Hand out what this wakeup accepted, a message per worker. */
+  QUEUE_FOREACH(q, (QUEUE*) &cluster->workers) {
+    worker = QUEUE_DATA(q, struct uv__cluster_worker, queue);
+    if (worker->nfds > 0 && !uv__io_active(&worker->io, UV__POLLOUT))
+      uv__cluster_flush(worker);
+  }
+}
+
+
+static void uv__cluster_maybe_close_cb(uv_cluster_t* cluster) {
+  uv_cluster_close_cb close_cb;
+
+  if (!(cluster->flags & UV__CLUSTER_CLOSED) || cluster->nworkers != 0)
+    return;
+
+  close_cb = cluster->close_cb;
+  cluster->close_cb = NULL;
+  if (close_cb != NULL)
+    close_cb(cluster);
+}
+
+
+static void uv__cluster_worker_free(uv_handle_t* handle) {
+  free(container_of(handle, struct uv__cluster_worker, process));
+}
+
+
+static void uv__cluster_exit(uv_process_t* process,
+                             int64_t exit_status,
+                             int term_signal) {
+  struct uv__cluster_worker* worker;
+  uv_cluster_t* cluster;
+
+  worker = container_of(process, struct uv__cluster_worker, process);
+  cluster = worker->cluster;
+
+  uv__cluster_channel_close(worker);
+
+  if (cluster->next_worker == (void*) &worker->queue)
+    cluster->next_worker = QUEUE_NEXT(&worker->queue);
+  QUEUE_REMOVE(&worker->queue);
+  cluster->nworkers--;
+
+  if (cluster->exit_cb != NULL)
+    cluster->exit_cb(cluster, process->pid, exit_status, term_signal);
+
+  uv_close((uv_handle_t*) process, uv__cluster_worker_free);
+  uv__cluster_maybe_close_cb(cluster);
+}
+
+
+int uv_cluster_init(uv_loop_t* loop,
+                    uv_cluster_t* cluster,
+                    uv_cluster_mode mode,
+                    uv_cluster_exit_cb exit_cb) {
+  if (mode != UV_CLUSTER_ROUND_ROBIN &&
+      mode != UV_CLUSTER_LEAST_LOAD &&
+      mode != UV_CLUSTER_SHARED) {
+    return -EINVAL;
+  }
+
+  cluster->loop = loop;
+  cluster->mode = mode;
+  cluster->nworkers = 0;
+  cluster->exit_cb = exit_cb;
+  cluster->close_cb = NULL;
+  cluster->flags = 0;
+  QUEUE_INIT((QUEUE*) &cluster->workers);
+  cluster->next_worker = &cluster->workers;
+
+  return uv_tcp_init(loop, &cluster->server);
+}
+
+
+int uv_cluster_spawn(uv_cluster_t* cluster,
+                     const uv_process_options_t* options) {
+  struct uv__cluster_worker* worker;
+  uv_stdio_container_t* stdio;
+  uv_process_options_t opts;
+  int stdio_count;
+  int fds[2];
+  int err;
+
+  if (cluster->flags & UV__CLUSTER_CLOSING)
+    return -EINVAL;
+
+  if (options->stdio_count > UV_CLUSTER_FD &&
+      options->stdio[UV_CLUSTER_FD].flags != UV_IGNORE) {
+    return -EINVAL;
+  }
+
+  stdio_count = options->stdio_count;
+  if (stdio_count <= UV_CLUSTER_FD)
+    stdio_count = UV_CLUSTER_FD + 1;
+
+  worker = malloc(sizeof(*worker));
+  stdio = calloc(stdio_count, sizeof(*stdio));
+  if (worker == NULL || stdio == NULL) {
+    free(worker);
+    free(stdio);
+    return -ENOMEM;
+  }
+
+  err = uv__make_socketpair(fds, 0);
+  if (err) {
+    free(worker);
+    free(stdio);
+    return err;
+  }
+
+  if (options->stdio_count > 0)
+    memcpy(stdio, options->stdio, options->stdio_count * sizeof(*stdio));
+  stdio[UV_CLUSTER_FD].flags = UV_INHERIT_FD;
+  stdio[UV_CLUSTER_FD].data.fd = fds[1];
+
+  opts = *options;
+  opts.exit_cb = uv__cluster_exit;
+  opts.stdio = stdio;
+  opts.stdio_count = stdio_count;
+
+  err = uv_spawn(cluster->loop, &worker->process, &opts);
+  uv__close(fds[1]);
+  free(stdio);
+
+  if (err) {
+    uv__close(fds[0]);
+    uv_close((uv_handle_t*) &worker->process, uv__cluster_worker_free);
+    return err;
+  }
+
+  uv__nonblock(fds[0], 1);
+  uv__io_init(&worker->io, uv__cluster_channel_io, fds[0]);
+  uv__io_start(cluster->loop, &worker->io, UV__POLLIN);
+
+  worker->cluster = cluster;
+  worker->fds = NULL;
+  worker->nfds = 0;
+  worker->size = 0;
+  worker->load = 0;
+  worker->send_listen = 0;
+  QUEUE_INSERT_TAIL((QUEUE*) &cluster->workers, &worker->queue);
+  cluster->nworkers++;
+
+  if (cluster->flags & UV__CLUSTER_LISTENING) {
+    if (cluster->mode == UV_CLUSTER_SHARED) {
+      worker->send_listen = 1;
+      uv__cluster_flush(worker);
+    } else {
+      uv__io_start(cluster->loop, &cluster->server.io_watcher, UV__POLLIN);
+    }
+  }
+
+  return 0;
+}
+
+
+int uv_cluster_listen(uv_cluster_t* cluster, int backlog) {
+  struct uv__cluster_worker* worker;
+  QUEUE* q;
+
+  if (cluster->flags & (UV__CLUSTER_LISTENING | UV__CLUSTER_CLOSING))
+    return -EINVAL;
+
+  if (cluster->server.delayed_error)
+    return cluster->server.delayed_error;
+
+  if (uv__stream_fd(&cluster->server) == -1)
+    return -EINVAL;
+
+  if (listen(uv__stream_fd(&cluster->server), backlog))
+    return -errno;
+
+  cluster->flags |= UV__CLUSTER_LISTENING;
+
+  if (cluster->mode == UV_CLUSTER_SHARED) {
+    QUEUE_FOREACH(q, (QUEUE*) &cluster->workers) {
+      worker = QUEUE_DATA(q, struct uv__cluster_worker, queue);
+      worker->send_listen = 1;
+      uv__cluster_flush(worker);
+    }
+
+    return 0;
+  }
+
+  cluster->server.io_watcher.cb = uv__cluster_accept_io;
+  uv__handle_start(&cluster->server);
+  if (cluster->nworkers > 0)
+    uv__io_start(cluster->loop, &cluster->server.io_watcher, UV__POLLIN);
+
+  return 0;
+}
+
+
+int uv_cluster_kill(uv_cluster_t* cluster, int signum) {
+  struct uv__cluster_worker* worker;
+  QUEUE* q;
+  int first;
+  int err;
+
+  first = 0;
+  QUEUE_FOREACH(q, (QUEUE*) &cluster->workers) {
+    worker = QUEUE_DATA(q, struct uv__cluster_worker, queue);
+    err = uv_process_kill(&worker->process, signum);
+    if (err && first == 0)
+      first = err;
+  }
+
+  return first;
+}
+
+
+static void uv__cluster_server_close(uv_handle_t* handle) {
+  uv_cluster_t* cluster;
+
+  cluster = container_of(handle, uv_cluster_t, server);
+  cluster->flags |= UV__CLUSTER_CLOSED;
+  uv__cluster_maybe_close_cb(cluster);
+}
+
+
+void uv_cluster_close(uv_cluster_t* cluster, uv_cluster_close_cb close_cb) {
+  struct uv__cluster_worker* worker;
+  QUEUE* q;
+
+  assert(!(cluster->flags & UV__CLUSTER_CLOSING));
+  cluster->flags |= UV__CLUSTER_CLOSING;
+  cluster->close_cb = close_cb;
+
+  QUEUE_FOREACH(q, (QUEUE*) &cluster->workers) {
+    worker = QUEUE_DATA(q, struct uv__cluster_worker, queue);
+    uv__cluster_channel_close(worker);
+  }
+
+  uv_close((uv_handle_t*) &cluster->server, uv__cluster_server_close);
+}
+
+
+static void uv__cluster_alloc(uv_handle_t* handle,
+                              size_t suggested_size,
+                              uv_buf_t* buf) {
+  uv_cluster_worker_t* worker;
+
+  worker = container_of(handle, uv_cluster_worker_t, ipc);
+  *buf = uv_buf_init(worker->buf, sizeof(worker->buf));
+}
+
+
+static void uv__cluster_server_cb(uv_stream_t* server, int status) {
+  uv_cluster_worker_t* worker;
+
+  worker = container_of(server, uv_cluster_worker_t, server);
+  worker->accept_from = server;
+  worker->connection_cb(worker, status);
+}
+
+
+static void uv__cluster_read(uv_stream_t* stream,
+                             ssize_t nread,
+                             const uv_buf_t* buf) {
+  uv_cluster_worker_t* worker;
+  ssize_t i;
+  int err;
+
+  worker = container_of(stream, uv_cluster_worker_t, ipc);
+
+  if (nread < 0) {
+    uv_read_stop(stream);
+    worker->accept_from = NULL;
+    worker->connection_cb(worker, nread);
+    return;
+  }
+
+  for (i = 0; i < nread; i++) {
+    if (buf->base[i] == UV__CLUSTER_LISTEN) {
+      err = uv_accept(stream, (uv_stream_t*) &worker->server);
+      if (err == 0) {
+        worker->flags |= UV__CLUSTER_WORKER_SHARED;
+        uv_tcp_exclusive_accept(&worker->server, 1);
+        err = uv_listen((uv_stream_t*) &worker->server,
+                        SOMAXCONN,
+                        uv__cluster_server_cb);
+      }
+
+      if (err) {
+        worker->accept_from = NULL;
+        worker->connection_cb(worker, err);
+      }
+      continue;
+    }
+
+    if (buf->base[i] == UV__CLUSTER_CONNECTION) {
+      worker->accept_from = stream;
+      worker->connection_cb(worker, 0);
+    }
+  }
+}
+
+
+int uv_cluster_worker_init(uv_loop_t* loop,
+                           uv_cluster_worker_t* worker,
+                           uv_cluster_connection_cb connection_cb) {
+  int err;
+
+  worker->loop = loop;
+  worker->connection_cb = connection_cb;
+  worker->accept_from = NULL;
+  worker->done_count = 0;
+  worker->flags = 0;
+  uv_tcp_init(loop, &worker->server);
+
+  err = uv_pipe_init(loop, &worker->ipc, 1);
+  if (err == 0)
+    err = uv_pipe_open(&worker->ipc, UV_CLUSTER_FD);
+  if (err == 0)
+    err = uv_read_start((uv_stream_t*) &worker->ipc,
+                        uv__cluster_alloc,
+                        uv__cluster_read);
+
+  if (err) {
+    uv_close((uv_handle_t*) &worker->server, NULL);
+    uv_close((uv_handle_t*) &worker->ipc, NULL);
+  }
+
+  return err;
+}
+
+
+int uv_cluster_accept(uv_cluster_worker_t* worker, uv_stream_t* client) {
+  if (worker->accept_from == NULL)
+    return -EAGAIN;
+
+  return uv_accept(worker->accept_from, client);
+}
+
+
+static void uv__cluster_report(uv_cluster_worker_t* worker);
+
+
+static void uv__cluster_report_cb(uv_write_t* req, int status) {
+  uv_cluster_worker_t* worker;
+
+  worker = container_of(req, uv_cluster_worker_t, done_req);
+  worker->flags &= ~UV__CLUSTER_WORKER_WRITING;
+
+  if (status == 0 && worker->done_count > 0)
+    uv__cluster_report(worker);
+}
+
+
+/* Reports what has been closed since the last write, a byte per connection. */
+static void uv__cluster_report(uv_cluster_worker_t* worker) {
+  static char done[UV__CLUSTER_BATCH];
+  unsigned int n;
+  uv_buf_t buf;
+
+  if (done[0] != UV__CLUSTER_DONE)
+    memset(done, UV__CLUSTER_DONE, sizeof(done));
+
+  n = worker->done_count;
+  if (n > sizeof(done))
+    n = sizeof(done);
+
+  buf = uv_buf_init(done, n);
+  if (uv_write(&worker->done_req,
+               (uv_stream_t*) &worker->ipc,
+               &buf,
+               1,
+               uv__cluster_report_cb)) {
+    return;
+  }
+
+  worker->done_count -= n;
+  worker->flags |= UV__CLUSTER_WORKER_WRITING;
+}
+
+
+int uv_cluster_done(uv_cluster_worker_t* worker) {
+  if (worker->flags & UV__CLUSTER_WORKER_SHARED)
+    return 0;
+
+  worker->done_count++;
+  if (!(worker->flags & UV__CLUSTER_WORKER_WRITING))
+    uv__cluster_report(worker);
+
+  return 0;
+}
+
+
+void uv_cluster_worker_close(uv_cluster_worker_t* worker) {
+  uv_close((uv_handle_t*) &worker->ipc, NULL);
+  uv_close((uv_handle_t*) &worker->server, NULL);
+}
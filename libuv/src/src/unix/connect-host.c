@@ -0,0 +1,445 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Happy Eyeballs connects, see uv_tcp_connect_host().
+ *
+ * The attempts are plain non-blocking sockets with a watcher each, only the
+ * winner becomes the handle's socket through uv__stream_open(). The state is
+ * on the heap rather than in the request: the request completes, and may be
+ * freed by its owner, while the delay timer is still closing or a cancelled
+ * lookup has yet to come back from the threadpool.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+/* Connection Attempt Delay, RFC 8305 section 5 recommends 250 ms and no
+ * less than 10 ms.
+ */
+#define UV__CONNECT_HOST_DELAY     250
+#define UV__CONNECT_HOST_DELAY_MIN 10
+
+/* struct uv__connect_host flags */
+enum {
+  UV__CONNECT_HOST_RESOLVING = 1,
+  UV__CONNECT_HOST_TIMER     = 2,  /* The timer is initialized. */
+  UV__CONNECT_HOST_STOPPED   = 4
+};
+
+struct uv__connect_host;
+
+struct uv__connect_attempt {
+  uv__io_t io;                     /* fd is -1 when not in progress. */
+  struct uv__connect_host* ch;
+  const struct addrinfo* ai;
+};
+
+struct uv__connect_host {
+  uv_connect_host_t* req;          /* NULL once the request completed. */
+  uv_getaddrinfo_t getaddrinfo_req;
+  uv_timer_t timer;
+  struct addrinfo* res;
+  struct uv__connect_attempt* attempts;
+  unsigned int nattempts;
+  unsigned int next;               /* Next attempt to start. */
+  unsigned int active;             /* Attempts in progress. */
+  unsigned int delay;
+  unsigned int flags;
+  int error;                       /* Error of the last failed attempt. */
+};
+
+
+static void uv__connect_host_next(struct uv__connect_host* ch);
+
+
+static void uv__connect_host_timer_close(uv_handle_t* handle) {
+  free(container_of(handle, struct uv__connect_host, timer));
+}
+
+
+static void uv__connect_host_abort(uv_loop_t* loop,
+                                   struct uv__connect_attempt* a) {
+  uv__io_close(loop, &a->io);
+  uv__close(a->io.fd);
+  a->io.fd = -1;
+}
+
+
+/* Stops everything still in flight, the request stays pending. */
+static void uv__connect_host_stop(struct uv__connect_host* ch) {
+  uv_loop_t* loop;
+  unsigned int i;
+
+  if (ch->flags & UV__CONNECT_HOST_STOPPED)
+    return;
+  ch->flags |= UV__CONNECT_HOST_STOPPED;
+
+  loop = ch->req->handle->loop;
+
+  if (ch->flags & UV__CONNECT_HOST_RESOLVING)
+    uv_cancel((uv_req_t*) &ch->getaddrinfo_req);
+
+  if (ch->flags & UV__CONNECT_HOST_TIMER)
+    uv_timer_stop(&ch->timer);
+
+  for (i = 0; i < ch->next; i++)
+    if (ch->attempts[i].io.fd != -1)
+      uv__connect_host_abort(loop, ch->attempts + i);
+
+  ch->next = ch->nattempts;
+  ch->active = 0;
+}
+
+
+static void uv__connect_host_finish(struct uv__connect_host* ch, int status) {
+  uv_connect_host_t* req;
+
+  uv__connect_host_stop(ch);
+
+  req = ch->req;
+  req->state = NULL;
+  req->handle->connect_host_req = NULL;
+  uv__req_unregister(req->handle->loop, req);
+
+  free(ch->attempts);
+  ch->attempts = NULL;
+  uv_freeaddrinfo(ch->res);
+  ch->res = NULL;
+  ch->req = NULL;
+
+  /* A lookup that couldn't be cancelled frees the state when it's done. */
+  if (ch->flags & UV__CONNECT_HOST_TIMER)
+    uv_close((uv_handle_t*) &ch->timer, uv__connect_host_timer_close);
+  else if (!(ch->flags & UV__CONNECT_HOST_RESOLVING))
+    free(ch);
+
+  req->cb(req, status);
+}
+
+
+static void uv__connect_host_io(uv_loop_t* loop,
+                                uv__io_t* w,
+                                unsigned int events) {
+  struct uv__connect_attempt* a;
+  struct uv__connect_host* ch;
+  uv_connect_host_t* req;
+  socklen_t errorsize;
+  int error;
+  int err;
+  int fd;
+
+  a = container_of(w, struct uv__connect_attempt, io);
+  ch = a->ch;
+  req = ch->req;
+  fd = w->fd;
+
+  error = 0;
+  errorsize = sizeof(error);
+  getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorsize);
+
+  if (error == EINPROGRESS)
+    return;
+
+  if (error != 0) {
+    uv__connect_host_abort(loop, a);
+    ch->active--;
+    ch->error = -error;
+    uv__connect_host_next(ch);
+    return;
+  }
+
+  /* Taken out of the attempts so uv__connect_host_finish() leaves it open. */
+  uv__io_close(loop, w);
+  w->fd = -1;
+
+  err = uv__stream_open((uv_stream_t*) req->handle,
+                        fd,
+                        UV_STREAM_READABLE | UV_STREAM_WRITABLE);
+  if (err) {
+    uv__close(fd);
+    uv__connect_host_finish(ch, err);
+    return;
+  }
+
+  if (a->ai->ai_family == AF_INET6)
+    req->handle->flags |= UV_HANDLE_IPV6;
+
+  memcpy(&req->addr, a->ai->ai_addr, a->ai->ai_addrlen);
+  uv__connect_host_finish(ch, 0);
+}
+
+
+static int uv__connect_host_start(uv_loop_t* loop,
+                                  struct uv__connect_attempt* a) {
+  int err;
+  int fd;
+  int r;
+
+  err = uv__socket(a->ai->ai_family, SOCK_STREAM, 0);
+  if (err < 0)
+    return err;
+  fd = err;
+
+  do
+    r = connect(fd, a->ai->ai_addr, a->ai->ai_addrlen);
+  while (r == -1 && errno == EINTR);
+
+  /* Errors that some platforms report straight away, like ECONNREFUSED on
+   * Solaris, fail the attempt right here instead of on the next tick.
+   */
+  if (r == -1 && errno != EINPROGRESS) {
+    err = -errno;
+    uv__close(fd);
+    return err;
+  }
+
+  a->io.fd = fd;
+  uv__io_start(loop, &a->io, UV__POLLOUT);
+
+  return 0;
+}
+
+
+static void uv__connect_host_timer(uv_timer_t* timer) {
+  uv__connect_host_next(container_of(timer, struct uv__connect_host, timer));
+}
+
+
+/* Starts the next attempt, and arms the timer for the one after that, or
+ * completes the request when there is nothing left to wait for.
+ */
+static void uv__connect_host_next(struct uv__connect_host* ch) {
+  struct uv__connect_attempt* a;
+  int err;
+
+  while (ch->next < ch->nattempts) {
+    a = ch->attempts + ch->next++;
+
+    err = uv__connect_host_start(ch->req->handle->loop, a);
+    if (err == 0) {
+      ch->active++;
+      if (ch->next < ch->nattempts)
+        uv_timer_start(&ch->timer, uv__connect_host_timer, ch->delay, 0);
+      return;
+    }
+
+    ch->error = err;
+  }
+
+  if (ch->active == 0)
+    uv__connect_host_finish(ch, ch->error);
+}
+
+
+static const struct addrinfo* uv__connect_host_find(const struct addrinfo* ai,
+                                                    int family) {
+  while (ai != NULL && ai->ai_family != family)
+    ai = ai->ai_next;
+  return ai;
+}
+
+
+/* Interleaves the addresses by family, RFC 8305 section 4. getaddrinfo()
+ * already sorted them by preference (RFC 6724), that order is kept within a
+ * family and the family of the first address goes first.
+ */
+static int uv__connect_host_sort(struct uv__connect_host* ch) {
+  struct uv__connect_attempt* a;
+  const struct addrinfo* first;
+  const struct addrinfo* second;
+  const struct addrinfo* ai;
+  unsigned int i;
+  unsigned int n;
+  int family;
+
+  n = 0;
+  for (ai = ch->res; ai != NULL; ai = ai->ai_next)
+    if (ai->ai_family == AF_INET || ai->ai_family == AF_INET6)
+      n++;
+
+  if (n == 0)
+    return UV_EAI_ADDRFAMILY;
+
+  ch->attempts = malloc(n * sizeof(*ch->attempts));
+  if (ch->attempts == NULL)
+    return -ENOMEM;
+
+  family = AF_INET6;
+  for (ai = ch->res; ai != NULL; ai = ai->ai_next) {
+    if (ai->ai_family == AF_INET || ai->ai_family == AF_INET6) {
+      family = ai->ai_family;
+      break;
+    }
+  }
+
+  first = uv__connect_host_find(ch->res, family);
+  second = uv__connect_host_find(ch->res,
+                                 family == AF_INET ? AF_INET6 : AF_INET);
+
+  for (i = 0; i < n; i++) {
+    a = ch->attempts + i;
+
+    if (second == NULL || (first != NULL && i % 2 == 0)) {
+      a->ai = first;
+      first = uv__connect_host_find(first->ai_next, first->ai_family);
+    } else {
+      a->ai = second;
+      second = uv__connect_host_find(second->ai_next, second->ai_family);
+    }
+
+    a->ch = ch;
+    uv__io_init(&a->io, uv__connect_host_io, -1);
+  }
+
+  ch->nattempts = n;
+
+  return 0;
+}
+
+
+static void uv__connect_host_resolved(uv_getaddrinfo_t* getaddrinfo_req,
+                                      int status,
+                                      struct addrinfo* res) {
+  struct uv__connect_host* ch;
+  uv_loop_t* loop;
+  int err;
+
+  ch = container_of(getaddrinfo_req, struct uv__connect_host, getaddrinfo_req);
+  ch->flags &= ~UV__CONNECT_HOST_RESOLVING;
+
+  if (ch->req == NULL) {
+    uv_freeaddrinfo(res);
+    free(ch);
+    return;
+  }
+
+  ch->res = res;
+
+  /* The handle is closing, uv__stream_destroy() completes the request. */
+  if (uv__is_closing(ch->req->handle))
+    return;
+
+  if (status != 0) {
+    uv__connect_host_finish(ch, status);
+    return;
+  }
+
+  err = uv__connect_host_sort(ch);
+  if (err) {
+    uv__connect_host_finish(ch, err);
+    return;
+  }
+
+  loop = ch->req->handle->loop;
+  uv_timer_init(loop, &ch->timer);
+  uv_unref((uv_handle_t*) &ch->timer);
+  ch->flags |= UV__CONNECT_HOST_TIMER;
+
+  uv__connect_host_next(ch);
+}
+
+
+int uv_tcp_connect_host(uv_connect_host_t* req,
+                        uv_tcp_t* handle,
+                        const char* node,
+                        const char* service,
+                        unsigned int delay,
+                        uv_connect_host_cb cb) {
+  struct uv__connect_host* ch;
+  struct addrinfo hints;
+  int err;
+
+  if (handle->type != UV_TCP ||
+      uv__is_closing(handle) ||
+      uv__stream_fd(handle) != -1) {
+    return -EINVAL;
+  }
+
+  if (handle->connect_req != NULL || handle->connect_host_req != NULL)
+    return -EALREADY;
+
+  ch = malloc(sizeof(*ch));
+  if (ch == NULL)
+    return -ENOMEM;
+
+  if (delay == 0)
+    delay = UV__CONNECT_HOST_DELAY;
+  else if (delay < UV__CONNECT_HOST_DELAY_MIN)
+    delay = UV__CONNECT_HOST_DELAY_MIN;
+
+  ch->req = req;
+  ch->res = NULL;
+  ch->attempts = NULL;
+  ch->nattempts = 0;
+  ch->next = 0;
+  ch->active = 0;
+  ch->delay = delay;
+  ch->flags = UV__CONNECT_HOST_RESOLVING;
+  ch->error = 0;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_TCP;
+
+  err = uv_getaddrinfo(handle->loop,
+                       &ch->getaddrinfo_req,
+                       uv__connect_host_resolved,
+                       node,
+                       service,
+                       &hints);
+  if (err) {
+    free(ch);
+    return err;
+  }
+
+  uv__req_init(handle->loop, req, UV_CONNECT_HOST);
+  req->cb = cb;
+  req->handle = handle;
+  req->state = ch;
+  memset(&req->addr, 0, sizeof(req->addr));
+  handle->connect_host_req = req;
+
+  return 0;
+}
+
+
+void uv__connect_host_close(uv_tcp_t* handle) {
+  uv_connect_host_t* req;
+
+  req = handle->connect_host_req;
+  if (req != NULL)
+    uv__connect_host_stop(req->state);
+}
+
+
+void uv__connect_host_cancel(uv_tcp_t* handle) {
+  uv_connect_host_t* req;
+
+  req = handle->connect_host_req;
+  if (req != NULL)
+    uv__connect_host_finish(req->state, -ECANCELED);
+}
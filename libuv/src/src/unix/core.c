@@ -41,6 +41,7 @@
 
 #ifdef __linux__
 # include <sys/ioctl.h>
+# include <linux/filter.h>
 #endif
 
 #ifdef __sun
@@ -282,6 +283,10 @@ int uv_backend_timeout(const uv_loop_t* loop) {
   if (!QUEUE_EMPTY(&loop->idle_handles))
     return 0;
 
+  /* E.g. write requests completed by uv__stream_flush_all(). */
+  if (!QUEUE_EMPTY(&loop->pending_queue))
+    return 0;
+
   if (loop->closing_handles)
     return 0;
 
@@ -317,6 +322,7 @@ int uv_run(uv_loop_t* loop, uv_run_mode mode) {
     uv__run_pending(loop);
     uv__run_idle(loop);
     uv__run_prepare(loop);
+    uv__stream_flush_all(loop);
 
     timeout = 0;
     if ((mode & UV_RUN_NOWAIT) == 0)
@@ -572,6 +578,53 @@ int uv__cloexec(int fd, int set) {
 #endif /* defined(__linux__) || defined(__FreeBSD__) || defined(__APPLE__) */
 
 
+/* Lets sockets that bind to the same address share it, the kernel spreads
+ * connections or datagrams across them.
+ */
+int uv__set_reuseport(int fd) {
+  int yes;
+
+  yes = 1;
+#if defined(__linux__) && defined(SO_REUSEPORT)
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)))
+    return -errno;
+  return 0;
+#elif defined(SO_REUSEPORT_LB)
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT_LB, &yes, sizeof(yes)))
+    return -errno;
+  return 0;
+#else
+  return -ENOTSUP;
+#endif
+}
+
+
+/* Makes the SO_REUSEPORT group of |fd| pick the socket whose index in the
+ * group matches the CPU the packet arrived on, out of range indices fall back
+ * to the hash. The program belongs to the group, so |fd| has to be bound (UDP)
+ * or listening (TCP) already.
+ */
+int uv__reuseport_steer_cpu(int fd) {
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+  static struct sock_filter code[] = {
+    { BPF_LD | BPF_W | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU },
+    { BPF_RET | BPF_A, 0, 0, 0 }
+  };
+  struct sock_fprog prog;
+
+  prog.len = ARRAY_SIZE(code);
+  prog.filter = code;
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                 &prog, sizeof(prog)))
+    return -errno;
+
+  return 0;
+#else
+  return -ENOTSUP;
+#endif
+}
+
+
 /* This function is not execve-safe, there is a race window
  * between the call to dup() and fcntl(FD_CLOEXEC).
  */
@@ -738,11 +791,20 @@ void uv__io_init(uv__io_t* w, uv__io_cb cb, int fd) {
   w->rcount = 0;
   w->wcount = 0;
 #endif /* defined(UV_HAVE_KQUEUE) */
+
+#if defined(__linux__)
+  w->edge = 0;
+  w->ready = 0;
+#endif /* defined(__linux__) */
 }
 
 
+/* UV__POLLERR on its own keeps the file descriptor registered when only the
+ * socket error queue is of interest, e.g. for MSG_ZEROCOPY completions. Only
+ * the Linux backends deliver it.
+ */
 void uv__io_start(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
-  assert(0 == (events & ~(UV__POLLIN | UV__POLLOUT)));
+  assert(0 == (events & ~(UV__POLLIN | UV__POLLOUT | UV__POLLERR)));
   assert(0 != events);
   assert(w->fd >= 0);
   assert(w->fd < INT_MAX);
@@ -775,7 +837,7 @@ void uv__io_start(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
 
 
 void uv__io_stop(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
-  assert(0 == (events & ~(UV__POLLIN | UV__POLLOUT)));
+  assert(0 == (events & ~(UV__POLLIN | UV__POLLOUT | UV__POLLERR)));
   assert(0 != events);
 
   if (w->fd == -1)
@@ -799,6 +861,12 @@ void uv__io_stop(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
       loop->watchers[w->fd] = NULL;
       loop->nfds--;
       w->events = 0;
+#if defined(__linux__)
+      /* Edges that arrive while the watcher is stopped are lost, assume the
+       * file descriptor is ready when it's started again.
+       */
+      w->ready |= UV__POLLIN | UV__POLLOUT;
+#endif /* defined(__linux__) */
     }
   }
   else if (QUEUE_EMPTY(&w->watcher_queue))
@@ -807,11 +875,15 @@ void uv__io_stop(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
 
 
 void uv__io_close(uv_loop_t* loop, uv__io_t* w) {
-  uv__io_stop(loop, w, UV__POLLIN | UV__POLLOUT);
+  uv__io_stop(loop, w, UV__POLLIN | UV__POLLOUT | UV__POLLERR);
   QUEUE_REMOVE(&w->pending_queue);
 
   /* Remove stale events for this file descriptor */
   uv__platform_invalidate_fd(loop, w->fd);
+
+#if defined(__linux__)
+  w->edge &= ~UV__IO_EDGE_ARMED;
+#endif /* defined(__linux__) */
 }
 
 
@@ -821,6 +893,16 @@ void uv__io_feed(uv_loop_t* loop, uv__io_t* w) {
 }
 
 
+/* Makes uv__io_poll() look at the watcher again on the next tick. For when
+ * another watcher's callback stopped short of EAGAIN on its file descriptor;
+ * an edge-triggered watcher won't hear from the kernel about that.
+ */
+void uv__io_requeue(uv_loop_t* loop, uv__io_t* w) {
+  if (w->pevents != 0 && QUEUE_EMPTY(&w->watcher_queue))
+    QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+}
+
+
 int uv__io_active(const uv__io_t* w, unsigned int events) {
   assert(0 == (events & ~(UV__POLLIN | UV__POLLOUT)));
   assert(0 != events);
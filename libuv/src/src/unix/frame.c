@@ -0,0 +1,274 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/* Framed reads, see uv_read_start_framed().
+ *
+ * uv__read() reads into the free space at the end of the stream's reassembly
+ * buffer and uv__frame_read() then hands out every complete frame straight
+ * from that buffer. Only the incomplete frame at the end, if any, is moved
+ * to the front, right before the next read.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UV__FRAME_BUF_SIZE (64 * 1024)
+
+#define UV__FRAME_LENGTH                                                      \
+  (UV_FRAME_LENGTH8 | UV_FRAME_LENGTH16 | UV_FRAME_LENGTH32)
+
+struct uv__frame_s {
+  unsigned int flags;
+  unsigned char delimiter;
+  size_t max_frame;
+  char* buf;
+  size_t size;     /* Capacity of buf. */
+  size_t start;    /* Offset of the first unconsumed byte. */
+  size_t len;      /* Number of unconsumed bytes. */
+  size_t scan;     /* Bytes already searched for the delimiter. */
+  size_t need;     /* Bytes the next frame takes up at least. */
+  int stalled;     /* read_cb stopped reading with frames left. */
+};
+
+
+int uv__frame_init(uv_stream_t* stream,
+                   unsigned int flags,
+                   int delimiter,
+                   size_t max_frame) {
+  struct uv__frame_s* f;
+  unsigned int kind;
+
+  kind = flags & (UV__FRAME_LENGTH | UV_FRAME_DELIMITER);
+  if (kind != UV_FRAME_LENGTH8 &&
+      kind != UV_FRAME_LENGTH16 &&
+      kind != UV_FRAME_LENGTH32 &&
+      kind != UV_FRAME_DELIMITER) {
+    return -EINVAL;
+  }
+
+  if (max_frame == 0)
+    return -EINVAL;
+
+  f = stream->frame;
+
+  /* Restarting with the same framing keeps what's buffered. */
+  if (f != NULL && (f->flags != flags || f->delimiter != delimiter)) {
+    uv__frame_free(stream);
+    f = NULL;
+  }
+
+  if (f == NULL) {
+    f = calloc(1, sizeof(*f));
+    if (f == NULL)
+      return -ENOMEM;
+    f->flags = flags;
+    f->delimiter = (unsigned char) delimiter;
+    stream->frame = f;
+  }
+
+  f->max_frame = max_frame;
+  return 0;
+}
+
+
+void uv__frame_free(uv_stream_t* stream) {
+  struct uv__frame_s* f;
+
+  f = stream->frame;
+  if (f == NULL)
+    return;
+
+  free(f->buf);
+  free(f);
+  stream->frame = NULL;
+}
+
+
+int uv__frame_pending(const uv_stream_t* stream) {
+  const struct uv__frame_s* f;
+
+  f = stream->frame;
+  return f != NULL && f->stalled;
+}
+
+
+int uv__frame_alloc(uv_stream_t* stream, uv_buf_t* buf) {
+  struct uv__frame_s* f;
+  size_t size;
+  char* p;
+
+  f = stream->frame;
+
+  /* Don't hold on to the memory of an unusually large frame. */
+  if (f->len == 0 && f->size > UV__FRAME_BUF_SIZE) {
+    free(f->buf);
+    f->buf = NULL;
+    f->size = 0;
+  }
+
+  if (f->start != 0) {
+    memmove(f->buf, f->buf + f->start, f->len);
+    f->start = 0;
+  }
+
+  size = f->size;
+  if (size < UV__FRAME_BUF_SIZE)
+    size = UV__FRAME_BUF_SIZE;
+  if (size < f->need) {
+    size = f->need;
+
+    /* A delimited frame's length isn't known up front. Grow geometrically
+     * rather than by whatever the last read brought in.
+     */
+    if ((f->flags & UV_FRAME_DELIMITER) && size < 2 * f->size) {
+      size = 2 * f->size;
+      if (size - 1 > f->max_frame)
+        size = f->max_frame + 1;
+      if (size < f->need)
+        size = f->need;
+    }
+  }
+
+  if (size != f->size) {
+    p = realloc(f->buf, size);
+    if (p == NULL)
+      return -ENOMEM;
+    f->buf = p;
+    f->size = size;
+  }
+
+  assert(f->len < f->size);
+  buf->base = f->buf + f->len;
+  buf->len = f->size - f->len;
+
+  return 0;
+}
+
+
+static size_t uv__frame_length(const struct uv__frame_s* f,
+                               const unsigned char* p,
+                               size_t n) {
+  size_t len;
+  size_t i;
+
+  len = 0;
+
+  if (f->flags & UV_FRAME_LITTLE_ENDIAN)
+    for (i = n; i > 0; i--)
+      len = (len << 8) | p[i - 1];
+  else
+    for (i = 0; i < n; i++)
+      len = (len << 8) | p[i];
+
+  return len;
+}
+
+
+void uv__frame_read(uv_stream_t* stream, ssize_t nread) {
+  struct uv__frame_s* f;
+  uv_buf_t frame;
+  size_t prefix;
+  size_t skip;
+  size_t n;
+  char* p;
+  char* q;
+
+  f = stream->frame;
+  f->len += nread;
+  f->stalled = 0;
+
+  if (f->flags & UV_FRAME_LENGTH8)
+    prefix = 1;
+  else if (f->flags & UV_FRAME_LENGTH16)
+    prefix = 2;
+  else if (f->flags & UV_FRAME_LENGTH32)
+    prefix = 4;
+  else
+    prefix = 0;
+
+  for (;;) {
+    p = f->buf + f->start;
+
+    if (f->flags & UV_FRAME_DELIMITER) {
+      q = memchr(p + f->scan, f->delimiter, f->len - f->scan);
+      if (q == NULL) {
+        if (f->len > f->max_frame)
+          break;
+        f->scan = f->len;
+        f->need = f->len + 1;
+        return;
+      }
+      n = q - p;
+      if (n > f->max_frame)
+        break;
+      skip = n + 1;
+      f->scan = 0;
+    } else {
+      if (f->len < prefix) {
+        f->need = prefix;
+        return;
+      }
+      n = uv__frame_length(f, (const unsigned char*) p, prefix);
+      if (n > f->max_frame)
+        break;
+      if (f->len - prefix < n) {
+        f->need = prefix + n;
+        return;
+      }
+      skip = prefix + n;
+    }
+
+    /* Consume the frame before the callback, read_cb may stop reading. */
+    frame.base = p + prefix;
+    frame.len = n;
+    f->start += skip;
+    f->len -= skip;
+    f->need = 0;
+    if (f->len == 0)
+      f->start = 0;
+
+    stream->read_cb(stream, n, &frame);
+
+    if (stream->frame != f)
+      return;  /* Restarted with different framing. */
+
+    if (!(stream->flags & UV_STREAM_READING) || stream->read_cb == NULL) {
+      f->stalled = (f->len != 0);
+      return;
+    }
+  }
+
+  /* The frame exceeds max_frame. There's no telling where the next one
+   * starts, drop everything that's buffered.
+   */
+  f->start = 0;
+  f->len = 0;
+  f->scan = 0;
+  f->need = 0;
+  frame = uv_buf_init(NULL, 0);
+  stream->read_cb(stream, UV_EMSGSIZE, &frame);
+}
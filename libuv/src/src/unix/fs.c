@@ -110,10 +110,23 @@
   }                                                                           \
   while (0)
 
+#if defined(__linux__)
+# define uv__fs_ring(loop, req) uv__iou_fs_submit((loop), (req), uv__fs_done)
+#else
+# define uv__fs_ring(loop, req) (-ENOSYS)
+#endif
+
 #define POST                                                                  \
   do {                                                                        \
     if ((cb) != NULL) {                                                       \
-      uv__work_submit((loop), &(req)->work_req, uv__fs_work, uv__fs_done);    \
+      if (uv__fs_ring((loop), (req)) == 0)                                    \
+        return 0;                                                             \
+      uv__work_submit((loop),                                                 \
+                      &(req)->work_req,                                       \
+                      uv__fs_work_class((req)->fs_type),                      \
+                      (req)->fs_type,                                         \
+                      uv__fs_work,                                            \
+                      uv__fs_done);                                           \
       return 0;                                                               \
     }                                                                         \
     else {                                                                    \
@@ -125,6 +138,21 @@
   while (0)
 
 
+/* Requests that can take much longer than a regular file system operation
+ * go to a separate lane of the thread pool.
+ */
+static uv_work_class uv__fs_work_class(uv_fs_type fs_type) {
+  switch (fs_type) {
+  case UV_FS_FSYNC:
+  case UV_FS_FDATASYNC:
+  case UV_FS_SENDFILE:
+    return UV_WORK_SLOW_IO;
+  default:
+    return UV_WORK_FAST_IO;
+  }
+}
+
+
 static ssize_t uv__fs_fdatasync(uv_fs_t* req) {
 #if defined(__linux__) || defined(__sun) || defined(__NetBSD__)
   return fdatasync(req->file);
@@ -179,6 +179,8 @@ int uv_getaddrinfo(uv_loop_t* loop,
 
   uv__work_submit(loop,
                   &req->work_req,
+                  UV_WORK_SLOW_IO,
+                  UV_THREADPOOL_STATS_GETADDRINFO,
                   uv__getaddrinfo_work,
                   uv__getaddrinfo_done);
 
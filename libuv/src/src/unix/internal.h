@@ -145,8 +145,51 @@ enum {
   UV_TCP_SINGLE_ACCEPT    = 0x1000, /* Only accept() when idle. */
   UV_HANDLE_IPV6          = 0x10000, /* Handle is bound to a IPv6 socket. */
   UV_HANDLE_NETLINK		  = 0x20000, /**/
+  UV_HANDLE_UDP_RECVMMSG  = 0x40000, /* Batch receives with recvmmsg(). */
+  UV_HANDLE_UDP_GRO       = 0x80000, /* UDP_GRO enabled on the socket. */
+  UV_TCP_EXCLUSIVE_ACCEPT = 0x100000, /* Wake up one loop per connection. */
+  UV_TCP_REUSEPORT_STEER  = 0x200000, /* Steer connections by CPU on listen. */
+  UV_TCP_ZEROCOPY         = 0x400000, /* Send large writes with MSG_ZEROCOPY. */
+  UV_STREAM_CORKED        = 0x800000, /* Hold writes until the loop polls. */
+  UV_STREAM_WRITE_HIGH    = 0x1000000 /* Write queue above high watermark. */
 };
 
+/* loop flags */
+enum {
+  UV_LOOP_EPOLLET = 1,  /* Edge-triggered epoll, see uv_loop_configure(). */
+  UV_LOOP_IOURING_POLL = 2  /* io_uring instead of epoll. */
+};
+
+#if defined(__linux__)
+/* uv__io_t edge flags */
+enum {
+  UV__IO_EDGE        = 1,  /* Watcher may be edge-triggered. */
+  UV__IO_EDGE_ARMED  = 2,  /* Registered with EPOLLET. */
+  UV__IO_EXCLUSIVE   = 4,  /* Registered with EPOLLEXCLUSIVE. */
+  UV__IO_RING_READ   = 8,  /* POLLIN reads ahead on the io_uring. */
+  UV__IO_RING_ACCEPT = 16  /* POLLIN accepts on the io_uring. */
+};
+
+/* Edge-triggered watchers only get an event when the file descriptor becomes
+ * ready.  Consumers call uv__io_drained() when read() or write() returns
+ * EAGAIN so the loop knows to wait for the next edge instead of handing them
+ * the remembered readiness again.
+ */
+# define uv__io_set_edge(w)        ((w)->edge |= UV__IO_EDGE)
+# define uv__io_set_exclusive(w)   ((w)->edge |= UV__IO_EXCLUSIVE)
+# define uv__io_set_ring(w, f)     ((w)->edge |= (f))
+# define uv__io_clear_ring(w, f)   ((w)->edge &= ~(f))
+# define uv__io_drained(w, events) ((w)->ready &= ~(events))
+# define uv__io_peer_closed(w)     (((w)->ready & UV__EPOLLRDHUP) != 0)
+#else
+# define uv__io_set_edge(w)        /* no-op */
+# define uv__io_set_exclusive(w)   /* no-op */
+# define uv__io_set_ring(w, f)     /* no-op */
+# define uv__io_clear_ring(w, f)   /* no-op */
+# define uv__io_drained(w, events) /* no-op */
+# define uv__io_peer_closed(w)     0
+#endif
+
 typedef enum {
   UV_CLOCK_PRECISE = 0,  /* Use the highest resolution clock available. */
   UV_CLOCK_FAST = 1      /* Use the fastest clock with <= 1ms granularity. */
@@ -164,6 +207,8 @@ int uv__nonblock(int fd, int set);
 int uv__close(int fd);
 int uv__cloexec(int fd, int set);
 int uv__socket(int domain, int type, int protocol);
+int uv__set_reuseport(int fd);
+int uv__reuseport_steer_cpu(int fd);
 int uv__dup(int fd);
 ssize_t uv__recvmsg(int fd, struct msghdr *msg, int flags);
 void uv__make_close_pending(uv_handle_t* handle);
@@ -173,6 +218,7 @@ void uv__io_start(uv_loop_t* loop, uv__io_t* w, unsigned int events);
 void uv__io_stop(uv_loop_t* loop, uv__io_t* w, unsigned int events);
 void uv__io_close(uv_loop_t* loop, uv__io_t* w);
 void uv__io_feed(uv_loop_t* loop, uv__io_t* w);
+void uv__io_requeue(uv_loop_t* loop, uv__io_t* w);
 int uv__io_active(const uv__io_t* w, unsigned int events);
 void uv__io_poll(uv_loop_t* loop, int timeout); /* in milliseconds or -1 */
 
@@ -192,11 +238,13 @@ void uv__stream_init(uv_loop_t* loop, uv_stream_t* stream,
     uv_handle_type type);
 int uv__stream_open(uv_stream_t*, int fd, int flags);
 void uv__stream_destroy(uv_stream_t* stream);
+void uv__stream_flush_all(uv_loop_t* loop);
 #if defined(__APPLE__)
 int uv__stream_try_select(uv_stream_t* stream, int* fd);
 #endif /* defined(__APPLE__) */
 void uv__server_io(uv_loop_t* loop, uv__io_t* w, unsigned int events);
 int uv__accept(int sockfd);
+int uv__emfile_trick(uv_loop_t* loop, int accept_fd);
 int uv__dup2_cloexec(int oldfd, int newfd);
 int uv__open_cloexec(const char* path, int flags);
 
@@ -204,13 +252,63 @@ int uv__open_cloexec(const char* path, int flags);
 int uv_tcp_listen(uv_tcp_t* tcp, int backlog, uv_connection_cb cb);
 int uv__tcp_nodelay(int fd, int on);
 int uv__tcp_keepalive(int fd, int on, unsigned int delay);
+int uv__tcp_zerocopy(int fd, int on);
+int uv__tcp_notsent_lowat(int fd, unsigned int bytes);
+void uv__connect_host_close(uv_tcp_t* handle);
+void uv__connect_host_cancel(uv_tcp_t* handle);
 
 /* pipe */
 int uv_pipe_listen(uv_pipe_t* handle, int backlog, uv_connection_cb cb);
 
+/* read buffer pool */
+#define UV__READ_POOL_CLASSES 3
+int uv__read_pool_init(uv_loop_t* loop);
+void uv__read_pool_close(uv_loop_t* loop);
+int uv__read_pool_get(uv_loop_t* loop, unsigned int size_class, uv_buf_t* buf);
+void uv__read_pool_put(uv_loop_t* loop, const uv_buf_t* buf);
+
+/* framed reads */
+int uv__frame_init(uv_stream_t* stream,
+                   unsigned int flags,
+                   int delimiter,
+                   size_t max_frame);
+void uv__frame_free(uv_stream_t* stream);
+int uv__frame_pending(const uv_stream_t* stream);
+int uv__frame_alloc(uv_stream_t* stream, uv_buf_t* buf);
+void uv__frame_read(uv_stream_t* stream, ssize_t nread);
+
+/* splice */
+void uv__splice_io(uv_stream_t* stream, unsigned int events);
+void uv__splice_close(uv_stream_t* stream);
+
+/* threadpool */
+int uv__work_stats_init(uv_loop_t* loop);
+void uv__work_loop_close(uv_loop_t* loop);
+
+#if defined(__linux__)
+/* io_uring */
+int uv__iou_fs_submit(uv_loop_t* loop,
+                      uv_fs_t* req,
+                      void (*done)(struct uv__work* w, int status));
+int uv__iou_flush(uv_loop_t* loop);
+void uv__iou_delete(uv_loop_t* loop);
+int uv__iou_poll_init(uv_loop_t* loop);
+void uv__iou_poll(uv_loop_t* loop, int timeout);
+void uv__iou_poll_invalidate(uv_loop_t* loop, int fd);
+ssize_t uv__iou_read(uv_loop_t* loop, uv__io_t* w, void* buf, size_t len);
+ssize_t uv__iou_write(uv_loop_t* loop,
+                      uv__io_t* w,
+                      const struct iovec* iov,
+                      int iovcnt,
+                      int ahead);
+int uv__iou_accept(uv_loop_t* loop, uv__io_t* w);
+int uv__iou_read_ahead(uv_loop_t* loop, uv__io_t* w);
+#endif
+
 /* timer */
 void uv__run_timers(uv_loop_t* loop);
 int uv__next_timeout(const uv_loop_t* loop);
+int uv__timer_wheel_init(uv_loop_t* loop);
 
 /* signal */
 void uv__signal_close(uv_signal_t* handle);
@@ -68,6 +68,11 @@
 # define CLOCK_BOOTTIME 7
 #endif
 
+/* Tags the epoll_event data of edge-triggered registrations. The lower 32 bits
+ * hold the file descriptor.
+ */
+#define UV__EPOLL_DATA_EDGE ((uint64_t) 1 << 32)
+
 static int read_models(unsigned int numcpus, uv_cpu_info_t* ci);
 static int read_times(unsigned int numcpus, uv_cpu_info_t* ci);
 static void read_speeds(unsigned int numcpus, uv_cpu_info_t* ci);
@@ -92,6 +97,8 @@ int uv__platform_loop_init(uv_loop_t* loop, int default_loop) {
   loop->backend_fd = fd;
   loop->inotify_fd = -1;
   loop->inotify_watchers = NULL;
+  loop->udp_mmsg = NULL;
+  loop->iou = NULL;
 
   if (fd == -1)
     return -errno;
@@ -101,6 +108,10 @@ int uv__platform_loop_init(uv_loop_t* loop, int default_loop) {
 
 
 void uv__platform_loop_delete(uv_loop_t* loop) {
+  free(loop->udp_mmsg);
+  loop->udp_mmsg = NULL;
+  uv__iou_delete(loop);
+
   if (loop->inotify_fd == -1) return;
   uv__io_stop(loop, &loop->inotify_read_watcher, UV__POLLIN);
   uv__close(loop->inotify_fd);
@@ -116,6 +127,11 @@ void uv__platform_invalidate_fd(uv_loop_t* loop, int fd) {
 
   assert(loop->watchers != NULL);
 
+  if (loop->flags & UV_LOOP_IOURING_POLL) {
+    uv__iou_poll_invalidate(loop, fd);
+    return;
+  }
+
   events = (struct uv__epoll_event*) loop->watchers[loop->nwatchers];
   nfds = (uintptr_t) loop->watchers[loop->nwatchers + 1];
   if (events != NULL)
@@ -135,10 +151,90 @@ void uv__platform_invalidate_fd(uv_loop_t* loop, int fd) {
 }
 
 
+/* Re-registers a file descriptor that epoll already knows about.
+ * EPOLLEXCLUSIVE registrations can't be modified, they're replaced.
+ */
+static int uv__epoll_rearm(int epfd, int fd, struct uv__epoll_event* e) {
+  if (!(e->events & UV__EPOLLEXCLUSIVE))
+    return uv__epoll_ctl(epfd, UV__EPOLL_CTL_MOD, fd, e);
+
+  if (uv__epoll_ctl(epfd, UV__EPOLL_CTL_DEL, fd, e))
+    return -1;
+
+  return uv__epoll_ctl(epfd, UV__EPOLL_CTL_ADD, fd, e);
+}
+
+
+/* Edge-triggered watchers are registered for both directions, once.  Interest
+ * changes after that are squelched in user space, see uv__io_edge_dispatch().
+ * Exclusive watchers are listening sockets, they only ever read and the
+ * kernel doesn't take EPOLLRDHUP together with EPOLLEXCLUSIVE.
+ */
+static int uv__io_edge_arm(uv_loop_t* loop, uv__io_t* w) {
+  struct uv__epoll_event e;
+
+  if (w->edge & UV__IO_EXCLUSIVE)
+    e.events = UV__EPOLLIN | UV__EPOLLET | UV__EPOLLEXCLUSIVE;
+  else
+    e.events = UV__EPOLLIN | UV__EPOLLOUT | UV__EPOLLRDHUP | UV__EPOLLET;
+  e.data = (uint64_t) w->fd | UV__EPOLL_DATA_EDGE;
+
+  if (uv__epoll_ctl(loop->backend_fd, UV__EPOLL_CTL_ADD, w->fd, &e)) {
+    if (errno != EEXIST)
+      return -errno;
+
+    /* We've reactivated a file descriptor that's been watched before. */
+    if (uv__epoll_rearm(loop->backend_fd, w->fd, &e))
+      return -errno;
+  }
+
+  w->edge |= UV__IO_EDGE_ARMED;
+  return 0;
+}
+
+
+/* Remember the readiness that epoll reported and hand the watcher the part
+ * that it's interested in.  An error or hangup is sticky and makes the file
+ * descriptor readable and writable for good; read() and write() will report
+ * it.  Not so for an error when the watcher asked for UV__POLLERR, it reads
+ * the socket error queue itself (MSG_ZEROCOPY notifications) and a read or
+ * write attempt for every notification would be wasted.  If the callback
+ * didn't drain the file descriptor (e.g. uv__read() ran out of its budget or
+ * the user stopped reading) the kernel won't tell us again, so put the
+ * watcher back on the watcher queue for the next tick.
+ */
+static int uv__io_edge_dispatch(uv_loop_t* loop,
+                                uv__io_t* w,
+                                unsigned int events) {
+  unsigned int revents;
+
+  if (events & UV__EPOLLHUP)
+    events |= UV__EPOLLIN | UV__EPOLLOUT;
+  else if ((events & UV__EPOLLERR) && !(w->pevents & UV__POLLERR))
+    events |= UV__EPOLLIN | UV__EPOLLOUT;
+
+  w->ready |= events;
+  revents = w->ready & (w->pevents | UV__POLLERR | UV__POLLHUP);
+
+  if ((revents & w->pevents) == 0)
+    return 0;
+
+  w->cb(loop, w, revents);
+
+  if ((w->ready & w->pevents & (UV__POLLIN | UV__POLLOUT)) &&
+      QUEUE_EMPTY(&w->watcher_queue)) {
+    QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+  }
+
+  return 1;
+}
+
+
 void uv__io_poll(uv_loop_t* loop, int timeout) {
   struct uv__epoll_event events[1024];
   struct uv__epoll_event* pe;
   struct uv__epoll_event e;
+  QUEUE ready_queue;
   QUEUE* q;
   uv__io_t* w;
   uint64_t base;
@@ -150,11 +246,22 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   int op;
   int i;
 
+  if (loop->flags & UV_LOOP_IOURING_POLL) {
+    uv__iou_poll(loop, timeout);
+    return;
+  }
+
+  /* Submit the file system requests of this tick in one go. */
+  if (uv__iou_flush(loop))
+    timeout = 0;
+
   if (loop->nfds == 0) {
     assert(QUEUE_EMPTY(&loop->watcher_queue));
     return;
   }
 
+  QUEUE_INIT(&ready_queue);
+
   while (!QUEUE_EMPTY(&loop->watcher_queue)) {
     q = QUEUE_HEAD(&loop->watcher_queue);
     QUEUE_REMOVE(q);
@@ -165,16 +272,37 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     assert(w->fd >= 0);
     assert(w->fd < (int) loop->nwatchers);
 
+    /* Watch it level-triggered if epoll won't take it edge-triggered. */
+    if ((w->edge & UV__IO_EDGE) &&
+        !(w->edge & UV__IO_EDGE_ARMED) &&
+        (loop->flags & UV_LOOP_EPOLLET) &&
+        uv__io_edge_arm(loop, w)) {
+      w->edge &= ~UV__IO_EDGE;
+    }
+
+    if (w->edge & UV__IO_EDGE_ARMED) {
+      w->events = w->pevents;
+
+      /* Ready since an earlier tick, no new edge is coming. */
+      if (w->ready & w->pevents)
+        QUEUE_INSERT_TAIL(&ready_queue, q);
+
+      continue;
+    }
+
     e.events = w->pevents;
     e.data = w->fd;
 
-    if (w->events == 0)
+    if (w->edge & UV__IO_EXCLUSIVE)
+      e.events |= UV__EPOLLEXCLUSIVE;
+
+    if (w->events == 0 || (w->edge & UV__IO_EXCLUSIVE))
       op = UV__EPOLL_CTL_ADD;
     else
       op = UV__EPOLL_CTL_MOD;
 
-    /* XXX Future optimization: do EPOLL_CTL_MOD lazily if we stop watching
-     * events, skip the syscall and squelch the events after epoll_wait().
+    /* Level-triggered watchers are re-registered for every change in their
+     * interest set.  Use UV_LOOP_EDGE_TRIGGERED to avoid that.
      */
     if (uv__epoll_ctl(loop->backend_fd, op, w->fd, &e)) {
       if (errno != EEXIST)
@@ -183,13 +311,26 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       assert(op == UV__EPOLL_CTL_ADD);
 
       /* We've reactivated a file descriptor that's been watched before. */
-      if (uv__epoll_ctl(loop->backend_fd, UV__EPOLL_CTL_MOD, w->fd, &e))
+      if (uv__epoll_rearm(loop->backend_fd, w->fd, &e))
         abort();
     }
 
     w->events = w->pevents;
   }
 
+  /* Callbacks can stop or close any watcher that's still on ready_queue,
+   * uv__io_stop() takes it off again.
+   */
+  while (!QUEUE_EMPTY(&ready_queue)) {
+    q = QUEUE_HEAD(&ready_queue);
+    QUEUE_REMOVE(q);
+    QUEUE_INIT(q);
+
+    w = QUEUE_DATA(q, uv__io_t, watcher_queue);
+    uv__io_edge_dispatch(loop, w, 0);
+    timeout = 0;
+  }
+
   assert(timeout >= -1);
   base = loop->time;
   count = 48; /* Benchmarks suggest this gives the best throughput. */
@@ -232,7 +373,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     loop->watchers[loop->nwatchers + 1] = (void*) (uintptr_t) nfds;
     for (i = 0; i < nfds; i++) {
       pe = events + i;
-      fd = pe->data;
+      fd = (int) (uint32_t) pe->data;
 
       /* Skip invalidated events, see uv__platform_invalidate_fd */
       if (fd == -1)
@@ -244,6 +385,12 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       w = loop->watchers[fd];
 
       if (w == NULL) {
+        /* Edge-triggered file descriptors stay registered while they're not
+         * watched, that's the point.
+         */
+        if (pe->data & UV__EPOLL_DATA_EDGE)
+          continue;
+
         /* File descriptor that we've stopped watching, disarm it.
          *
          * Ignore all errors because we may be racing with another thread
@@ -253,6 +400,11 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
         continue;
       }
 
+      if (w->edge & UV__IO_EDGE_ARMED) {
+        nevents += uv__io_edge_dispatch(loop, w, pe->events);
+        continue;
+      }
+
       /* Give users only events they're interested in. Prevents spurious
        * callbacks when previous callback invocation in this loop has stopped
        * the current watcher. Also, filters out events that users has not
@@ -272,8 +424,8 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
        * hangup and the kernel won't report EPOLLIN again because there's
        * nothing left to read.  If anything, libuv is to blame here.  The
        * current hack is just a quick bandaid; to properly fix it, libuv
-       * needs to remember the error/hangup event.  We should get that for
-       * free when we switch over to edge-triggered I/O.
+       * needs to remember the error/hangup event, which is what edge-triggered
+       * watchers do, see uv__io_edge_dispatch().
        */
       if (pe->events == UV__EPOLLERR || pe->events == UV__EPOLLHUP)
         pe->events |= w->pevents & (UV__EPOLLIN | UV__EPOLLOUT);
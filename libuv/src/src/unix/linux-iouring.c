@@ -0,0 +1,1553 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* File system requests on an io_uring.
+ *
+ * Every loop gets a ring the first time it runs a file system request that
+ * the ring can do. Requests are queued on the submission ring as they come
+ * in and handed to the kernel in one go when the loop is about to poll. The
+ * ring file descriptor is watched like any other, it's readable when there
+ * are completions to reap.
+ *
+ * When the kernel doesn't do io_uring (before 5.6 the opcodes used here
+ * didn't exist), or it's been disabled with UV_USE_IO_URING=0, or the ring
+ * is full, the request goes to the thread pool like it always did.
+ *
+ * With UV_LOOP_IO_URING the ring replaces epoll as well. File descriptors
+ * are watched with one-shot poll requests that are re-armed after every
+ * event, and a single io_uring_enter() per iteration submits them together
+ * with everything else and waits for completions.
+ *
+ * Stream sockets and pipes do their I/O on the ring too. POLLIN on a reading
+ * stream becomes a read into a buffer that the kernel picks from a pool of
+ * the loop (5.19 and later, before that reading streams poll), on a listening
+ * socket an accept. The watcher is then called as if the file descriptor had
+ * become readable, and uv__iou_read() and uv__iou_accept() hand out the
+ * result in place of the system call, so reads from the ring cost a copy out
+ * of the pool. Writes are tried right away like always; what doesn't fit is
+ * copied into a write request that takes the place of polling for POLLOUT.
+ * UDP handles and everything else only poll.
+ *
+ * Completions are told apart by their user_data: a file system request is a
+ * pointer to the uv_fs_t, a write is a pointer to its copy of the data with
+ * bit 1 set. The poll, read and accept requests of a file descriptor have
+ * the low bit set and carry the file descriptor, the kind of request and a
+ * sequence number, so a late completion of a request that was replaced or
+ * cancelled can be recognized and cleaned up after.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/sysmacros.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define UV__IOU_ENTRIES 64
+
+/* Stream reads go into buffers of this size from a ring that's registered
+ * with the kernel, which gets another slab of them when it runs out.
+ */
+#define UV__IOU_BUF_GROUP 1
+#define UV__IOU_BUF_SIZE (16 * 1024)
+#define UV__IOU_BUF_SLAB 32
+#define UV__IOU_BUF_SLABS 32
+#define UV__IOU_BUF_ENTRIES (UV__IOU_BUF_SLAB * UV__IOU_BUF_SLABS)
+
+/* Most a write request copies at a time. */
+#define UV__IOU_WRITE_MAX (64 * 1024)
+
+/* user_data of requests whose completion we don't care about. */
+#define UV__IOU_IGNORE 0
+
+/* Kinds of requests on a file descriptor. */
+enum {
+  UV__IOU_POLL = 0,
+  UV__IOU_READ = 1,
+  UV__IOU_ACCEPT = 2
+};
+
+#define UV__IOU_FD_DATA(fd, kind, seq)                                        \
+  (((uint64_t) (seq) << 32) | ((uint64_t) (fd) << 3) | ((kind) << 1) | 1)
+#define UV__IOU_DATA_FD(data) ((int) (((data) >> 3) & 0x1fffffff))
+#define UV__IOU_DATA_KIND(data) ((int) (((data) >> 1) & 3))
+#define UV__IOU_WRITE_DATA(wr) ((uintptr_t) (wr) | 2)
+
+STATIC_ASSERT(sizeof(struct uv__io_uring_sqe) == 64);
+STATIC_ASSERT(sizeof(struct uv__io_uring_cqe) == 16);
+STATIC_ASSERT(sizeof(struct uv__io_uring_params) == 120);
+STATIC_ASSERT(sizeof(struct uv__io_uring_buf) == 16);
+STATIC_ASSERT(sizeof(struct uv__io_uring_buf_reg) == 40);
+STATIC_ASSERT(sizeof(struct uv__statx) == 256);
+
+/* A write request, its copy of the data follows. */
+struct uv__iou_write {
+  int fd;
+};
+
+/* What the ring does for a file descriptor. */
+struct uv__iou_fd {
+  uint64_t poll;  /* user_data of the poll request, 0 if none. */
+  uint64_t read;  /* Same for the read or accept. */
+  struct uv__iou_write* write;  /* The write in flight, NULL if none. */
+  unsigned int events;  /* What the poll request is for. */
+  int rres;  /* Bytes read, an accepted fd or a negated errno. */
+  unsigned int rpos;  /* Bytes handed out so far. */
+  int wres;  /* Bytes written or a negated errno. */
+  unsigned short rbid;  /* The buffer that was read into. */
+  unsigned char rdone;  /* Kind of the finished read or accept, 0 if none. */
+  unsigned char wdone;  /* Non-zero if wres is valid. */
+  unsigned char rpoll;  /* Poll for POLLIN once (1) or always (2). */
+};
+
+/* A request that uv__iou_queue() had to put off. */
+struct uv__iou_deferred {
+  uint64_t arg;
+  int opcode;
+};
+
+struct uv__iou {
+  uv__io_t io_watcher;
+  int ringfd;
+  char* sq;
+  size_t sqlen;
+  char* cq;
+  size_t cqlen;
+  struct uv__io_uring_sqe* sqe;
+  size_t sqelen;
+  uint32_t* sqhead;
+  uint32_t* sqtail;
+  uint32_t* sqarray;
+  uint32_t sqmask;
+  uint32_t* cqhead;
+  uint32_t* cqtail;
+  struct uv__io_uring_cqe* cqe;
+  uint32_t cqmask;
+  unsigned int unsubmitted;  /* Queued but not yet handed to the kernel. */
+  unsigned int in_flight;    /* Queued and not yet reaped. */
+  unsigned int max_in_flight;
+  uint32_t features;
+  struct uv__iou_fd* fds;  /* Indexed by file descriptor. */
+  unsigned int nfds;
+  unsigned int nops;  /* Reads, writes and accepts in flight. */
+  struct uv__iou_deferred* deferred;
+  unsigned int ndeferred;
+  unsigned int maxdeferred;
+  int* ready;  /* File descriptors with results for their watchers. */
+  unsigned int nready;
+  unsigned int maxready;
+  struct uv__io_uring_buf* bufs;  /* The buffer ring, NULL if none. */
+  uint16_t buftail;
+  int nobufs;  /* Non-zero if the kernel can't do buffer rings. */
+  char* slabs[UV__IOU_BUF_SLABS];
+  unsigned int nslabs;
+  uint32_t seq;
+};
+
+static int no_io_uring;
+
+static void uv__iou_io(uv_loop_t* loop, uv__io_t* w, unsigned int events);
+static void uv__iou_cancel_wait(uv_loop_t* loop, struct uv__iou* iou);
+
+
+static void uv__iou_unmap(struct uv__iou* iou) {
+  if (iou->sqe != MAP_FAILED)
+    munmap(iou->sqe, iou->sqelen);
+  if (iou->cq != MAP_FAILED && iou->cq != iou->sq)
+    munmap(iou->cq, iou->cqlen);
+  if (iou->sq != MAP_FAILED)
+    munmap(iou->sq, iou->sqlen);
+}
+
+
+static struct uv__iou* uv__iou_get(uv_loop_t* loop) {
+  struct uv__io_uring_params p;
+  struct uv__iou* iou;
+  const char* val;
+  int ringfd;
+
+  if (loop->iou != NULL)
+    return loop->iou;
+
+  if (no_io_uring)
+    return NULL;
+
+  val = getenv("UV_USE_IO_URING");
+  if (val != NULL && atoi(val) == 0) {
+    no_io_uring = 1;
+    return NULL;
+  }
+
+  memset(&p, 0, sizeof(p));
+  ringfd = uv__io_uring_setup(UV__IOU_ENTRIES, &p);
+  if (ringfd == -1) {
+    /* Not supported or not allowed, don't try again. Running out of memory
+     * or file descriptors is only a reason to fall back this time.
+     */
+    if (errno != ENOMEM && errno != EMFILE && errno != ENFILE)
+      no_io_uring = 1;
+    return NULL;
+  }
+
+  /* RW_CUR_POS came with 5.6, like the open, close and statx opcodes. */
+  if ((p.features & UV__IORING_FEAT_NODROP) == 0 ||
+      (p.features & UV__IORING_FEAT_RW_CUR_POS) == 0) {
+    no_io_uring = 1;
+    uv__close(ringfd);
+    return NULL;
+  }
+
+  iou = malloc(sizeof(*iou));
+  if (iou == NULL) {
+    uv__close(ringfd);
+    return NULL;
+  }
+
+  iou->ringfd = ringfd;
+  iou->sqlen = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+  iou->cqlen = p.cq_off.cqes + p.cq_entries * sizeof(*iou->cqe);
+  iou->sqelen = p.sq_entries * sizeof(*iou->sqe);
+
+  if (p.features & UV__IORING_FEAT_SINGLE_MMAP) {
+    if (iou->cqlen > iou->sqlen)
+      iou->sqlen = iou->cqlen;
+    iou->cqlen = iou->sqlen;
+  }
+
+  iou->sq = mmap(NULL,
+                 iou->sqlen,
+                 PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE,
+                 ringfd,
+                 UV__IORING_OFF_SQ_RING);
+
+  iou->cq = iou->sq;
+  if (!(p.features & UV__IORING_FEAT_SINGLE_MMAP))
+    iou->cq = mmap(NULL,
+                   iou->cqlen,
+                   PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE,
+                   ringfd,
+                   UV__IORING_OFF_CQ_RING);
+
+  iou->sqe = mmap(NULL,
+                  iou->sqelen,
+                  PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE,
+                  ringfd,
+                  UV__IORING_OFF_SQES);
+
+  if (iou->sq == MAP_FAILED ||
+      iou->cq == MAP_FAILED ||
+      iou->sqe == MAP_FAILED) {
+    uv__iou_unmap(iou);
+    uv__close(ringfd);
+    free(iou);
+    return NULL;
+  }
+
+  iou->sqhead = (uint32_t*) (iou->sq + p.sq_off.head);
+  iou->sqtail = (uint32_t*) (iou->sq + p.sq_off.tail);
+  iou->sqarray = (uint32_t*) (iou->sq + p.sq_off.array);
+  iou->sqmask = *(uint32_t*) (iou->sq + p.sq_off.ring_mask);
+  iou->cqhead = (uint32_t*) (iou->cq + p.cq_off.head);
+  iou->cqtail = (uint32_t*) (iou->cq + p.cq_off.tail);
+  iou->cqe = (struct uv__io_uring_cqe*) (iou->cq + p.cq_off.cqes);
+  iou->cqmask = *(uint32_t*) (iou->cq + p.cq_off.ring_mask);
+  iou->unsubmitted = 0;
+  iou->in_flight = 0;
+  iou->max_in_flight = p.cq_entries;
+  iou->features = p.features;
+  iou->fds = NULL;
+  iou->nfds = 0;
+  iou->nops = 0;
+  iou->deferred = NULL;
+  iou->ndeferred = 0;
+  iou->maxdeferred = 0;
+  iou->ready = NULL;
+  iou->nready = 0;
+  iou->maxready = 0;
+  iou->bufs = NULL;
+  iou->buftail = 0;
+  iou->nobufs = 0;
+  iou->nslabs = 0;
+  iou->seq = 0;
+
+  uv__io_init(&iou->io_watcher, uv__iou_io, ringfd);
+  uv__io_start(loop, &iou->io_watcher, UV__POLLIN);
+  loop->iou = iou;
+
+  return iou;
+}
+
+
+void uv__iou_delete(uv_loop_t* loop) {
+  struct uv__iou* iou;
+
+  iou = loop->iou;
+  if (iou == NULL)
+    return;
+
+  assert(iou->in_flight == 0);
+  uv__iou_cancel_wait(loop, iou);
+  uv__io_stop(loop, &iou->io_watcher, UV__POLLIN);
+  uv__iou_unmap(iou);
+  uv__close(iou->ringfd);
+  if (iou->bufs != NULL)
+    munmap(iou->bufs, UV__IOU_BUF_ENTRIES * sizeof(*iou->bufs));
+  while (iou->nslabs > 0)
+    free(iou->slabs[--iou->nslabs]);
+  free(iou->fds);
+  free(iou->deferred);
+  free(iou->ready);
+  free(iou);
+  loop->iou = NULL;
+}
+
+
+/* Hands the queued requests to the kernel. Returns non-zero when some of them
+ * are still waiting, the loop shouldn't block then.
+ */
+int uv__iou_flush(uv_loop_t* loop) {
+  struct uv__iou* iou;
+  int r;
+
+  iou = loop->iou;
+  if (iou == NULL || iou->unsubmitted == 0)
+    return 0;
+
+  do
+    r = uv__io_uring_enter(iou->ringfd, iou->unsubmitted, 0, 0, NULL, 0);
+  while (r == -1 && errno == EINTR);
+
+  /* Out of memory for the moment, try again next tick. */
+  if (r == -1 && errno != EAGAIN && errno != EBUSY)
+    abort();
+
+  iou->unsubmitted = *iou->sqtail - ACCESS_ONCE(uint32_t, *iou->sqhead);
+  return iou->unsubmitted != 0;
+}
+
+
+static struct uv__io_uring_sqe* uv__iou_get_sqe(uv_loop_t* loop,
+                                                struct uv__iou* iou) {
+  struct uv__io_uring_sqe* sqe;
+  uint32_t slot;
+  uint32_t tail;
+
+  tail = *iou->sqtail;
+  if (tail - ACCESS_ONCE(uint32_t, *iou->sqhead) > iou->sqmask) {
+    uv__iou_flush(loop);
+    if (tail - ACCESS_ONCE(uint32_t, *iou->sqhead) > iou->sqmask)
+      return NULL;
+  }
+
+  slot = tail & iou->sqmask;
+  iou->sqarray[slot] = slot;
+  sqe = &iou->sqe[slot];
+  memset(sqe, 0, sizeof(*sqe));
+
+  return sqe;
+}
+
+
+/* The kernel only looks at the tail in io_uring_enter(). */
+static void uv__iou_commit_sqe(struct uv__iou* iou) {
+  ACCESS_ONCE(uint32_t, *iou->sqtail) = *iou->sqtail + 1;
+  iou->unsubmitted++;
+}
+
+
+static int uv__iou_fs_queue(uv_loop_t* loop,
+                            struct uv__iou* iou,
+                            uv_fs_t* req) {
+  struct uv__io_uring_sqe* sqe;
+
+  /* Completions must always fit, we don't wait for the kernel to make room.
+   * The requests on file descriptors don't count, there are at most a few
+   * per file descriptor and the kernel holds on to what doesn't fit.
+   */
+  if (iou->in_flight >= iou->max_in_flight)
+    return -EBUSY;
+
+  sqe = uv__iou_get_sqe(loop, iou);
+  if (sqe == NULL)
+    return -EBUSY;
+
+  sqe->user_data = (uintptr_t) req;
+
+  switch (req->fs_type) {
+  case UV_FS_CLOSE:
+    sqe->opcode = UV__IORING_OP_CLOSE;
+    sqe->fd = req->file;
+    break;
+
+  case UV_FS_FDATASYNC:
+    sqe->opcode = UV__IORING_OP_FSYNC;
+    sqe->fd = req->file;
+    sqe->op_flags = UV__IORING_FSYNC_DATASYNC;
+    break;
+
+  case UV_FS_FSYNC:
+    sqe->opcode = UV__IORING_OP_FSYNC;
+    sqe->fd = req->file;
+    break;
+
+  case UV_FS_OPEN:
+    sqe->opcode = UV__IORING_OP_OPENAT;
+    sqe->fd = UV__AT_FDCWD;
+    sqe->addr = (uintptr_t) req->path;
+    sqe->len = req->mode;
+    sqe->op_flags = req->flags | O_CLOEXEC;
+    break;
+
+  case UV_FS_READ:
+  case UV_FS_WRITE:
+    if (req->fs_type == UV_FS_READ)
+      sqe->opcode = UV__IORING_OP_READV;
+    else
+      sqe->opcode = UV__IORING_OP_WRITEV;
+    sqe->fd = req->file;
+    sqe->addr = (uintptr_t) req->bufs;
+    sqe->len = req->nbufs;
+    sqe->off = req->off < 0 ? (uint64_t) -1 : (uint64_t) req->off;
+    break;
+
+  case UV_FS_FSTAT:
+  case UV_FS_LSTAT:
+  case UV_FS_STAT:
+    sqe->opcode = UV__IORING_OP_STATX;
+    sqe->fd = UV__AT_FDCWD;
+    sqe->addr = (uintptr_t) req->path;
+    sqe->len = UV__STATX_BASIC_STATS;
+    sqe->off = (uintptr_t) req->ptr;
+    if (req->fs_type == UV_FS_LSTAT)
+      sqe->op_flags = UV__AT_SYMLINK_NOFOLLOW;
+    if (req->fs_type == UV_FS_FSTAT) {
+      sqe->fd = req->file;
+      sqe->addr = (uintptr_t) "";
+      sqe->op_flags = UV__AT_EMPTY_PATH;
+    }
+    break;
+
+  default:
+    abort();
+  }
+
+  uv__iou_commit_sqe(iou);
+  iou->in_flight++;
+
+  return 0;
+}
+
+
+/* Runs |req| on the ring and calls |done| when it's finished, the same way
+ * the thread pool would. Returns non-zero when the caller should use the
+ * thread pool instead.
+ */
+int uv__iou_fs_submit(uv_loop_t* loop,
+                      uv_fs_t* req,
+                      void (*done)(struct uv__work* w, int status)) {
+  struct uv__iou* iou;
+  int err;
+
+  switch (req->fs_type) {
+  case UV_FS_CLOSE:
+  case UV_FS_FDATASYNC:
+  case UV_FS_FSTAT:
+  case UV_FS_FSYNC:
+  case UV_FS_LSTAT:
+  case UV_FS_OPEN:
+  case UV_FS_READ:
+  case UV_FS_STAT:
+  case UV_FS_WRITE:
+    break;
+  default:
+    return -ENOSYS;
+  }
+
+  iou = uv__iou_get(loop);
+  if (iou == NULL)
+    return -ENOSYS;
+
+  if (req->fs_type == UV_FS_FSTAT ||
+      req->fs_type == UV_FS_LSTAT ||
+      req->fs_type == UV_FS_STAT) {
+    req->ptr = malloc(sizeof(struct uv__statx));
+    if (req->ptr == NULL)
+      return -ENOMEM;
+  }
+
+  err = uv__iou_fs_queue(loop, iou, req);
+  if (err) {
+    free(req->ptr);
+    req->ptr = NULL;
+    return err;
+  }
+
+  req->work_req.loop = loop;
+  req->work_req.work = NULL;  /* Tells uv_cancel() it's too late. */
+  req->work_req.done = done;
+
+  return 0;
+}
+
+
+static void uv__iou_statx_to_stat(const struct uv__statx* src,
+                                  uv_stat_t* dst) {
+  dst->st_dev = makedev(src->stx_dev_major, src->stx_dev_minor);
+  dst->st_mode = src->stx_mode;
+  dst->st_nlink = src->stx_nlink;
+  dst->st_uid = src->stx_uid;
+  dst->st_gid = src->stx_gid;
+  dst->st_rdev = makedev(src->stx_rdev_major, src->stx_rdev_minor);
+  dst->st_ino = src->stx_ino;
+  dst->st_size = src->stx_size;
+  dst->st_blksize = src->stx_blksize;
+  dst->st_blocks = src->stx_blocks;
+  dst->st_atim.tv_sec = src->stx_atime.tv_sec;
+  dst->st_atim.tv_nsec = src->stx_atime.tv_nsec;
+  dst->st_mtim.tv_sec = src->stx_mtime.tv_sec;
+  dst->st_mtim.tv_nsec = src->stx_mtime.tv_nsec;
+  dst->st_ctim.tv_sec = src->stx_ctime.tv_sec;
+  dst->st_ctim.tv_nsec = src->stx_ctime.tv_nsec;
+
+  /* Same as what the thread pool gets from stat(), whichever path a request
+   * takes shouldn't show.
+   */
+  dst->st_birthtim.tv_sec = src->stx_ctime.tv_sec;
+  dst->st_birthtim.tv_nsec = src->stx_ctime.tv_nsec;
+
+  dst->st_flags = 0;
+  dst->st_gen = 0;
+}
+
+
+static void uv__iou_fs_done(uv_loop_t* loop, uv_fs_t* req, int res) {
+  struct uv__statx* statxbuf;
+
+  /* The thread pool retries too, except for close(). */
+  if (res == -EINTR && req->fs_type != UV_FS_CLOSE)
+    if (uv__iou_fs_queue(loop, loop->iou, req) == 0)
+      return;
+
+  switch (req->fs_type) {
+  case UV_FS_READ:
+  case UV_FS_WRITE:
+    if (req->bufs != req->bufsml)
+      free(req->bufs);
+    break;
+
+  case UV_FS_FSTAT:
+  case UV_FS_LSTAT:
+  case UV_FS_STAT:
+    statxbuf = req->ptr;
+    req->ptr = NULL;
+    if (res == 0) {
+      uv__iou_statx_to_stat(statxbuf, &req->statbuf);
+      req->ptr = &req->statbuf;
+    }
+    free(statxbuf);
+    break;
+
+  default:
+    break;
+  }
+
+  req->result = res;
+  req->work_req.done(&req->work_req, 0);
+}
+
+
+/* The ring's side of |fd|, grown on demand. */
+static struct uv__iou_fd* uv__iou_fd_get(uv_loop_t* loop,
+                                         struct uv__iou* iou,
+                                         int fd) {
+  struct uv__iou_fd* fds;
+  unsigned int n;
+
+  if ((unsigned) fd >= iou->nfds) {
+    n = loop->nwatchers;
+    if ((unsigned) fd >= n)
+      n = fd + 1;
+    fds = realloc(iou->fds, n * sizeof(*fds));
+    if (fds == NULL)
+      abort();
+    memset(fds + iou->nfds, 0, (n - iou->nfds) * sizeof(*fds));
+    iou->fds = fds;
+    iou->nfds = n;
+  }
+
+  return &iou->fds[fd];
+}
+
+
+static char* uv__iou_buf(struct uv__iou* iou, unsigned int bid) {
+  return iou->slabs[bid / UV__IOU_BUF_SLAB] +
+         (bid % UV__IOU_BUF_SLAB) * UV__IOU_BUF_SIZE;
+}
+
+
+/* Hands buffer |bid| (back) to the kernel. */
+static void uv__iou_buf_put(struct uv__iou* iou, unsigned int bid) {
+  struct uv__io_uring_buf* b;
+
+  b = &iou->bufs[iou->buftail & (UV__IOU_BUF_ENTRIES - 1)];
+  b->addr = (uintptr_t) uv__iou_buf(iou, bid);
+  b->len = UV__IOU_BUF_SIZE;
+  b->bid = bid;
+
+  /* The tail is the resv field of the first entry, don't touch it above. */
+  __sync_synchronize();
+  iou->buftail++;
+  ACCESS_ONCE(uint16_t, iou->bufs[0].resv) = iou->buftail;
+}
+
+
+/* Hands the kernel another slab of buffers to read into, registering the
+ * buffer ring first if need be. That's 5.19 and later, -ENOSYS means reads
+ * stay off the ring.
+ */
+static int uv__iou_buf_grow(struct uv__iou* iou) {
+  struct uv__io_uring_buf_reg reg;
+  struct uv__io_uring_buf* bufs;
+  unsigned int i;
+  char* slab;
+
+  if (iou->nobufs)
+    return -ENOSYS;
+
+  if (iou->nslabs == UV__IOU_BUF_SLABS)
+    return -ENOBUFS;
+
+  if (iou->bufs == NULL) {
+    bufs = mmap(NULL,
+                UV__IOU_BUF_ENTRIES * sizeof(*bufs),
+                PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS,
+                -1,
+                0);
+    if (bufs == MAP_FAILED)
+      return -ENOMEM;
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uintptr_t) bufs;
+    reg.ring_entries = UV__IOU_BUF_ENTRIES;
+    reg.bgid = UV__IOU_BUF_GROUP;
+
+    if (uv__io_uring_register(iou->ringfd,
+                              UV__IORING_REGISTER_PBUF_RING,
+                              &reg,
+                              1)) {
+      munmap(bufs, UV__IOU_BUF_ENTRIES * sizeof(*bufs));
+      if (errno == ENOMEM)
+        return -ENOMEM;
+      iou->nobufs = 1;
+      return -ENOSYS;
+    }
+
+    iou->bufs = bufs;
+  }
+
+  slab = malloc(UV__IOU_BUF_SLAB * UV__IOU_BUF_SIZE);
+  if (slab == NULL)
+    return -ENOMEM;
+
+  iou->slabs[iou->nslabs++] = slab;
+  for (i = 0; i < UV__IOU_BUF_SLAB; i++)
+    uv__iou_buf_put(iou, (iou->nslabs - 1) * UV__IOU_BUF_SLAB + i);
+
+  return 0;
+}
+
+
+static int uv__iou_queue_now(uv_loop_t* loop,
+                             struct uv__iou* iou,
+                             int opcode,
+                             uint64_t arg) {
+  struct uv__io_uring_sqe* sqe;
+
+  sqe = uv__iou_get_sqe(loop, iou);
+  if (sqe == NULL)
+    return -EBUSY;
+
+  sqe->opcode = opcode;
+  sqe->fd = -1;
+  sqe->addr = arg;
+  sqe->user_data = UV__IOU_IGNORE;
+  uv__iou_commit_sqe(iou);
+  return 0;
+}
+
+
+/* Queues the removal of a poll request or the cancellation of a read, write
+ * or accept. When the ring is full the request waits for the next
+ * uv__iou_poll(), nothing else depends on it.
+ */
+static void uv__iou_queue(uv_loop_t* loop,
+                          struct uv__iou* iou,
+                          int opcode,
+                          uint64_t arg) {
+  struct uv__iou_deferred* deferred;
+  unsigned int n;
+
+  if (uv__iou_queue_now(loop, iou, opcode, arg) == 0)
+    return;
+
+  if (iou->ndeferred == iou->maxdeferred) {
+    n = iou->maxdeferred ? 2 * iou->maxdeferred : UV__IOU_ENTRIES;
+    deferred = realloc(iou->deferred, n * sizeof(*deferred));
+    if (deferred == NULL)
+      abort();
+    iou->deferred = deferred;
+    iou->maxdeferred = n;
+  }
+
+  iou->deferred[iou->ndeferred].arg = arg;
+  iou->deferred[iou->ndeferred].opcode = opcode;
+  iou->ndeferred++;
+}
+
+
+/* Queues what uv__iou_queue() had to put off. */
+static void uv__iou_queue_deferred(uv_loop_t* loop, struct uv__iou* iou) {
+  struct uv__iou_deferred* d;
+
+  while (iou->ndeferred > 0) {
+    d = &iou->deferred[iou->ndeferred - 1];
+    if (uv__iou_queue_now(loop, iou, d->opcode, d->arg))
+      break;
+    iou->ndeferred--;
+  }
+}
+
+
+/* Calls the watcher of |fd| for what the ring read, accepted or wrote, as if
+ * the file descriptor had become readable or writable.
+ */
+static int uv__iou_dispatch(uv_loop_t* loop, struct uv__iou* iou, int fd) {
+  struct uv__iou_fd* f;
+  unsigned int events;
+  uv__io_t* w;
+
+  w = loop->watchers[fd];
+  if (w == NULL)
+    return 0;
+
+  f = &iou->fds[fd];
+  events = 0;
+  if (f->rdone != 0 && (w->pevents & UV__POLLIN))
+    events |= UV__POLLIN;
+  if (f->wdone != 0 && (w->pevents & UV__POLLOUT))
+    events |= UV__POLLOUT;
+
+  if (events == 0)
+    return 0;
+
+  /* Look at it again on the next tick, like after a poll event. */
+  w->events = 0;
+  if (QUEUE_EMPTY(&w->watcher_queue))
+    QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+
+  w->cb(loop, w, events);
+  return 1;
+}
+
+
+static int uv__iou_poll_done(uv_loop_t* loop,
+                             struct uv__iou* iou,
+                             uint64_t data,
+                             int res) {
+  unsigned int events;
+  uv__io_t* w;
+  int fd;
+
+  fd = UV__IOU_DATA_FD(data);
+
+  /* Replaced or removed, and possibly for a file that's long gone. */
+  if ((unsigned) fd >= iou->nfds || iou->fds[fd].poll != data)
+    return 0;
+
+  iou->fds[fd].poll = 0;
+  iou->fds[fd].events = 0;
+
+  w = loop->watchers[fd];
+  if (w == NULL)
+    return 0;
+
+  /* One-shot, arm it again on the next tick unless the callback stops it. */
+  w->events = 0;
+  if (QUEUE_EMPTY(&w->watcher_queue))
+    QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+
+  if (res < 0)
+    events = UV__POLLERR;
+  else
+    events = res & (w->pevents | UV__POLLERR | UV__POLLHUP);
+
+  /* Same as with epoll, let uv__read() and uv__write() find the error. */
+  if (events == UV__POLLERR || events == UV__POLLHUP)
+    events |= w->pevents & (UV__POLLIN | UV__POLLOUT);
+
+  if (events == 0)
+    return 0;
+
+  w->cb(loop, w, events);
+  return 1;
+}
+
+
+static int uv__iou_read_done(uv_loop_t* loop,
+                             struct uv__iou* iou,
+                             const struct uv__io_uring_cqe* cqe) {
+  struct uv__iou_fd* f;
+  uv__io_t* w;
+  int kind;
+  int res;
+  int fd;
+
+  fd = UV__IOU_DATA_FD(cqe->user_data);
+  kind = UV__IOU_DATA_KIND(cqe->user_data);
+  res = cqe->res;
+
+  assert(iou->nops > 0);
+  iou->nops--;
+
+  f = NULL;
+  if ((unsigned) fd < iou->nfds && iou->fds[fd].read == cqe->user_data)
+    f = &iou->fds[fd];
+
+  /* Only data is worth keeping the buffer for. */
+  if ((cqe->flags & UV__IORING_CQE_F_BUFFER) && (f == NULL || res <= 0))
+    uv__iou_buf_put(iou, cqe->flags >> UV__IORING_CQE_BUFFER_SHIFT);
+
+  /* Cancelled when the file descriptor was closed. */
+  if (f == NULL) {
+    if (kind == UV__IOU_ACCEPT && res >= 0)
+      uv__close(res);
+    return 0;
+  }
+
+  f->read = 0;
+
+  /* Out of buffers, or the kernel won't wait for this file descriptor. Try
+   * again or poll and let the watcher do the system call.
+   */
+  if (res == -ENOBUFS ||
+      res == -EAGAIN ||
+      res == -EINTR ||
+      res == -ECANCELED) {
+    if (res == -EAGAIN)
+      f->rpoll = 2;
+    else if (res == -ENOBUFS && uv__iou_buf_grow(iou))
+      f->rpoll = 1;
+
+    w = loop->watchers[fd];
+    if (w != NULL) {
+      w->events = 0;
+      uv__io_requeue(loop, w);
+    }
+    return 0;
+  }
+
+  assert(kind != UV__IOU_READ ||
+         res <= 0 ||
+         (cqe->flags & UV__IORING_CQE_F_BUFFER));
+
+  f->rdone = kind;
+  f->rres = res;
+  f->rpos = 0;
+  f->rbid = cqe->flags >> UV__IORING_CQE_BUFFER_SHIFT;
+
+  return uv__iou_dispatch(loop, iou, fd);
+}
+
+
+static int uv__iou_write_done(uv_loop_t* loop,
+                              struct uv__iou* iou,
+                              const struct uv__io_uring_cqe* cqe) {
+  struct uv__iou_write* wr;
+  struct uv__iou_fd* f;
+  int fd;
+
+  wr = (struct uv__iou_write*) (uintptr_t) (cqe->user_data & ~(uint64_t) 3);
+  fd = wr->fd;
+
+  assert(iou->nops > 0);
+  iou->nops--;
+
+  /* The kernel is done with the copy either way. */
+  if ((unsigned) fd >= iou->nfds || iou->fds[fd].write != wr) {
+    free(wr);
+    return 0;
+  }
+
+  free(wr);
+  f = &iou->fds[fd];
+  f->write = NULL;
+  f->wres = cqe->res;
+  f->wdone = 1;
+
+  return uv__iou_dispatch(loop, iou, fd);
+}
+
+
+/* Runs the callbacks of everything that completed. Returns the number of
+ * watcher and file system callbacks that ran.
+ */
+static int uv__iou_reap(uv_loop_t* loop, struct uv__iou* iou) {
+  struct uv__io_uring_cqe cqes[UV__IOU_ENTRIES * 2];
+  uint64_t data;
+  uint32_t head;
+  uint32_t tail;
+  uint32_t n;
+  uint32_t i;
+  int nevents;
+
+  nevents = 0;
+
+  for (;;) {
+    head = *iou->cqhead;
+    tail = ACCESS_ONCE(uint32_t, *iou->cqtail);
+    if (head == tail)
+      break;
+
+    /* Copy the entries out so the kernel can reuse the slots before we run
+     * the callbacks, which may well queue more requests.
+     */
+    __sync_synchronize();
+    n = tail - head;
+    if (n > ARRAY_SIZE(cqes))
+      n = ARRAY_SIZE(cqes);
+    for (i = 0; i < n; i++)
+      cqes[i] = iou->cqe[(head + i) & iou->cqmask];
+    __sync_synchronize();
+    ACCESS_ONCE(uint32_t, *iou->cqhead) = head + n;
+
+    for (i = 0; i < n; i++) {
+      data = cqes[i].user_data;
+
+      if (data == UV__IOU_IGNORE)
+        continue;
+
+      if ((data & 1) && UV__IOU_DATA_KIND(data) == UV__IOU_POLL) {
+        nevents += uv__iou_poll_done(loop, iou, data, cqes[i].res);
+        continue;
+      }
+
+      if (data & 1) {
+        nevents += uv__iou_read_done(loop, iou, &cqes[i]);
+        continue;
+      }
+
+      if (data & 2) {
+        nevents += uv__iou_write_done(loop, iou, &cqes[i]);
+        continue;
+      }
+
+      assert(iou->in_flight > 0);
+      iou->in_flight--;
+      uv__iou_fs_done(loop, (uv_fs_t*) (uintptr_t) data, cqes[i].res);
+      nevents++;
+    }
+  }
+
+  return nevents;
+}
+
+
+static void uv__iou_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
+  uv__iou_reap(loop, container_of(w, struct uv__iou, io_watcher));
+}
+
+
+/* Reads, writes and accepts that the kernel isn't done with use memory of
+ * the ring, cancel them and wait for that. What's still to come is stale
+ * then, no callbacks run.
+ */
+static void uv__iou_cancel_wait(uv_loop_t* loop, struct uv__iou* iou) {
+  unsigned int i;
+  int r;
+
+  for (i = 0; i < iou->nfds; i++)
+    uv__iou_poll_invalidate(loop, i);
+
+  while (iou->nops > 0) {
+    uv__iou_queue_deferred(loop, iou);
+
+    r = uv__io_uring_enter(iou->ringfd,
+                           iou->unsubmitted,
+                           1,
+                           UV__IORING_ENTER_GETEVENTS,
+                           NULL,
+                           0);
+
+    if (r == -1 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+      abort();
+
+    iou->unsubmitted = *iou->sqtail - ACCESS_ONCE(uint32_t, *iou->sqhead);
+    uv__iou_reap(loop, iou);
+  }
+}
+
+
+/* Switches |loop| from epoll to the ring. The epoll file descriptor stays
+ * around for uv_backend_fd(), with just the ring in it.
+ */
+int uv__iou_poll_init(uv_loop_t* loop) {
+  struct uv__epoll_event e;
+  struct uv__iou* iou;
+  unsigned int i;
+  uv__io_t* w;
+
+  if (loop->flags & UV_LOOP_IOURING_POLL)
+    return 0;
+
+  if (loop->flags & UV_LOOP_EPOLLET)
+    return -EINVAL;
+
+  iou = uv__iou_get(loop);
+  if (iou == NULL)
+    return -ENOSYS;
+
+  /* 5.11, for the timeout argument of io_uring_enter(). */
+  if ((iou->features & UV__IORING_FEAT_POLL_32BITS) == 0 ||
+      (iou->features & UV__IORING_FEAT_EXT_ARG) == 0)
+    return -ENOSYS;
+
+  uv__io_stop(loop, &iou->io_watcher, UV__POLLIN);
+
+  e.events = UV__EPOLLIN;
+  e.data = iou->ringfd;
+  if (uv__epoll_ctl(loop->backend_fd, UV__EPOLL_CTL_ADD, iou->ringfd, &e))
+    if (errno != EEXIST)
+      return -errno;
+
+  /* Move what's registered with epoll over to the ring. */
+  for (i = 0; i < loop->nwatchers; i++) {
+    w = loop->watchers[i];
+    if (w == NULL || w->events == 0 || w == &iou->io_watcher)
+      continue;
+
+    uv__epoll_ctl(loop->backend_fd, UV__EPOLL_CTL_DEL, w->fd, &e);
+    w->events = 0;
+    if (QUEUE_EMPTY(&w->watcher_queue))
+      QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+  }
+
+  loop->flags |= UV_LOOP_IOURING_POLL;
+  return 0;
+}
+
+
+/* Reads ahead into a buffer of the kernel's choosing, or accepts, in place of
+ * polling for POLLIN. Returns -ENOBUFS when the caller should poll instead.
+ */
+static int uv__iou_read_submit(uv_loop_t* loop,
+                               struct uv__iou* iou,
+                               uv__io_t* w,
+                               struct uv__iou_fd* f) {
+  struct uv__io_uring_sqe* sqe;
+  int kind;
+
+  if (!(w->edge & UV__IO_RING_ACCEPT) && iou->nslabs == 0)
+    if (uv__iou_buf_grow(iou))
+      return -ENOBUFS;
+
+  sqe = uv__iou_get_sqe(loop, iou);
+  if (sqe == NULL)
+    return -EBUSY;
+
+  if (w->edge & UV__IO_RING_ACCEPT) {
+    kind = UV__IOU_ACCEPT;
+    sqe->opcode = UV__IORING_OP_ACCEPT;
+    sqe->op_flags = UV__SOCK_NONBLOCK | UV__SOCK_CLOEXEC;
+  } else {
+    kind = UV__IOU_READ;
+    sqe->opcode = UV__IORING_OP_READ;
+    sqe->flags = UV__IOSQE_BUFFER_SELECT;
+    sqe->len = UV__IOU_BUF_SIZE;
+    sqe->off = (uint64_t) -1;
+    sqe->buf_group = UV__IOU_BUF_GROUP;
+  }
+
+  sqe->fd = w->fd;
+  sqe->user_data = UV__IOU_FD_DATA(w->fd, kind, iou->seq++);
+  uv__iou_commit_sqe(iou);
+
+  f->read = sqe->user_data;
+  iou->nops++;
+
+  return 0;
+}
+
+
+static int uv__iou_poll_arm(uv_loop_t* loop, struct uv__iou* iou, uv__io_t* w) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou_fd* f;
+  unsigned int events;
+  int ready;
+  int err;
+
+  f = uv__iou_fd_get(loop, iou, w->fd);
+  events = w->pevents;
+  ready = 0;
+
+  /* A read or accept on the ring takes the place of polling for POLLIN. */
+  if ((events & UV__POLLIN) &&
+      (w->edge & (UV__IO_RING_READ | UV__IO_RING_ACCEPT)) &&
+      f->rpoll == 0) {
+    err = 0;
+    if (f->rdone != 0)
+      ready = 1;
+    else if (f->read == 0)
+      err = uv__iou_read_submit(loop, iou, w, f);
+
+    if (err == -EBUSY)
+      return err;
+
+    if (err == 0)
+      events &= ~UV__POLLIN;
+  }
+
+  /* Same for a write and POLLOUT. */
+  if (f->write != NULL || f->wdone != 0) {
+    if (f->wdone != 0 && (events & UV__POLLOUT))
+      ready = 1;
+    events &= ~UV__POLLOUT;
+  }
+
+  if (f->poll != 0 && f->events != events) {
+    uv__iou_queue(loop, iou, UV__IORING_OP_POLL_REMOVE, f->poll);
+    f->poll = 0;
+    f->events = 0;
+  }
+
+  if (events != 0 && f->poll == 0) {
+    sqe = uv__iou_get_sqe(loop, iou);
+    if (sqe == NULL)
+      return -EBUSY;
+
+    sqe->opcode = UV__IORING_OP_POLL_ADD;
+    sqe->fd = w->fd;
+    sqe->op_flags = events;
+    sqe->user_data = UV__IOU_FD_DATA(w->fd, UV__IOU_POLL, iou->seq++);
+    uv__iou_commit_sqe(iou);
+
+    f->poll = sqe->user_data;
+    f->events = events;
+
+    if (f->rpoll == 1 && (events & UV__POLLIN))
+      f->rpoll = 0;
+  }
+
+  if (ready) {
+    if (iou->nready == iou->maxready) {
+      iou->maxready = iou->maxready ? 2 * iou->maxready : UV__IOU_ENTRIES;
+      iou->ready = realloc(iou->ready, iou->maxready * sizeof(*iou->ready));
+      if (iou->ready == NULL)
+        abort();
+    }
+    iou->ready[iou->nready++] = w->fd;
+  }
+
+  w->events = w->pevents;
+  return 0;
+}
+
+
+/* Requests on the ring hold on to the file, closing the file descriptor
+ * doesn't get rid of them. They're cancelled and forgotten right away, so
+ * that their completions are dropped and the file descriptor can be watched
+ * again. What the ring read or accepted and nobody picked up goes too.
+ */
+void uv__iou_poll_invalidate(uv_loop_t* loop, int fd) {
+  struct uv__iou_fd* f;
+  struct uv__iou* iou;
+
+  iou = loop->iou;
+  if (iou == NULL || (unsigned) fd >= iou->nfds)
+    return;
+
+  f = &iou->fds[fd];
+
+  if (f->poll != 0)
+    uv__iou_queue(loop, iou, UV__IORING_OP_POLL_REMOVE, f->poll);
+
+  if (f->read != 0)
+    uv__iou_queue(loop, iou, UV__IORING_OP_ASYNC_CANCEL, f->read);
+
+  if (f->write != NULL)
+    uv__iou_queue(loop,
+                  iou,
+                  UV__IORING_OP_ASYNC_CANCEL,
+                  UV__IOU_WRITE_DATA(f->write));
+
+  if (f->rdone == UV__IOU_READ && f->rres > 0)
+    uv__iou_buf_put(iou, f->rbid);
+
+  if (f->rdone == UV__IOU_ACCEPT && f->rres >= 0)
+    uv__close(f->rres);
+
+  memset(f, 0, sizeof(*f));
+}
+
+
+/* read() for streams, hands out what the ring read ahead first. Doesn't read
+ * while the ring is reading, the data would come out of order.
+ */
+ssize_t uv__iou_read(uv_loop_t* loop, uv__io_t* w, void* buf, size_t len) {
+  struct uv__iou_fd* f;
+  struct uv__iou* iou;
+  ssize_t r;
+  size_t n;
+  int full;
+
+  iou = loop->iou;
+  if (!(loop->flags & UV_LOOP_IOURING_POLL) || (unsigned) w->fd >= iou->nfds)
+    return read(w->fd, buf, len);
+
+  f = &iou->fds[w->fd];
+
+  if (f->read != 0) {
+    errno = EAGAIN;
+    return -1;
+  }
+
+  if (f->rdone != UV__IOU_READ)
+    return read(w->fd, buf, len);
+
+  if (f->rres <= 0) {
+    f->rdone = 0;
+    if (f->rres == 0)
+      return 0;
+    errno = -f->rres;
+    return -1;
+  }
+
+  n = f->rres - f->rpos;
+  if (n > len)
+    n = len;
+
+  memcpy(buf, uv__iou_buf(iou, f->rbid) + f->rpos, n);
+  f->rpos += n;
+
+  if (f->rpos < (unsigned int) f->rres)
+    return n;
+
+  full = (f->rres == UV__IOU_BUF_SIZE);
+  f->rdone = 0;
+  uv__iou_buf_put(iou, f->rbid);
+
+  if (!full || n == len)
+    return n;
+
+  /* The buffer filled up, there's likely more. */
+  do
+    r = read(w->fd, (char*) buf + n, len - n);
+  while (r == -1 && errno == EINTR);
+
+  if (r > 0)
+    return n + r;
+
+  /* Keep EOF and errors for the next call. */
+  if (r == 0 || errno != EAGAIN) {
+    f->rdone = UV__IOU_READ;
+    f->rres = r == 0 ? 0 : -errno;
+  }
+
+  return n;
+}
+
+
+/* Whether the ring is reading for |w| or holds on to data it read. */
+int uv__iou_read_ahead(uv_loop_t* loop, uv__io_t* w) {
+  struct uv__iou_fd* f;
+  struct uv__iou* iou;
+
+  iou = loop->iou;
+  if (iou == NULL || (unsigned) w->fd >= iou->nfds)
+    return 0;
+
+  f = &iou->fds[w->fd];
+  return f->read != 0 || f->rdone != 0;
+}
+
+
+/* uv__accept() for listening streams, hands out what the ring accepted. */
+int uv__iou_accept(uv_loop_t* loop, uv__io_t* w) {
+  struct uv__iou_fd* f;
+  struct uv__iou* iou;
+
+  iou = loop->iou;
+  if ((loop->flags & UV_LOOP_IOURING_POLL) && (unsigned) w->fd < iou->nfds) {
+    f = &iou->fds[w->fd];
+
+    if (f->read != 0)
+      return -EAGAIN;
+
+    if (f->rdone == UV__IOU_ACCEPT) {
+      f->rdone = 0;
+      return f->rres;
+    }
+  }
+
+  return uv__accept(w->fd);
+}
+
+
+/* Copies what the last write left over, from |skip| bytes in, into a write
+ * request. The kernel waits for room in the socket buffer and uv__iou_write()
+ * returns the result the next time.
+ */
+static void uv__iou_write_submit(uv_loop_t* loop,
+                                 struct uv__iou* iou,
+                                 uv__io_t* w,
+                                 struct uv__iou_fd* f,
+                                 const struct iovec* iov,
+                                 int iovcnt,
+                                 size_t skip) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou_write* wr;
+  size_t chunk;
+  size_t len;
+  size_t n;
+  char* p;
+  int i;
+
+  len = 0;
+  for (i = 0; i < iovcnt; i++)
+    len += iov[i].iov_len;
+
+  if (skip >= len)
+    return;
+
+  len -= skip;
+  if (len > UV__IOU_WRITE_MAX)
+    len = UV__IOU_WRITE_MAX;
+
+  wr = malloc(sizeof(*wr) + len);
+  if (wr == NULL)
+    return;
+
+  sqe = uv__iou_get_sqe(loop, iou);
+  if (sqe == NULL) {
+    free(wr);
+    return;
+  }
+
+  p = (char*) (wr + 1);
+  for (i = 0, n = 0; n < len; i++) {
+    if (skip >= iov[i].iov_len) {
+      skip -= iov[i].iov_len;
+      continue;
+    }
+
+    chunk = iov[i].iov_len - skip;
+    if (chunk > len - n)
+      chunk = len - n;
+
+    memcpy(p + n, (char*) iov[i].iov_base + skip, chunk);
+    n += chunk;
+    skip = 0;
+  }
+
+  wr->fd = w->fd;
+
+  sqe->opcode = UV__IORING_OP_WRITE;
+  sqe->fd = w->fd;
+  sqe->addr = (uintptr_t) p;
+  sqe->len = len;
+  sqe->off = (uint64_t) -1;
+  sqe->user_data = UV__IOU_WRITE_DATA(wr);
+  uv__iou_commit_sqe(iou);
+
+  f->write = wr;
+  iou->nops++;
+
+  /* Let uv__iou_poll_arm() drop the poll for POLLOUT. */
+  w->events = 0;
+  uv__io_requeue(loop, w);
+}
+
+
+/* writev() for streams. With |ahead|, what doesn't fit goes to the ring. */
+ssize_t uv__iou_write(uv_loop_t* loop,
+                      uv__io_t* w,
+                      const struct iovec* iov,
+                      int iovcnt,
+                      int ahead) {
+  struct uv__iou_fd* f;
+  ssize_t n;
+
+  f = NULL;
+
+  if (loop->flags & UV_LOOP_IOURING_POLL) {
+    f = uv__iou_fd_get(loop, loop->iou, w->fd);
+
+    if (f->write != NULL) {
+      errno = EAGAIN;
+      return -1;
+    }
+
+    if (f->wdone != 0) {
+      f->wdone = 0;
+      if (f->wres < 0) {
+        errno = -f->wres;
+        return -1;
+      }
+      return f->wres;
+    }
+  }
+
+  if (iovcnt == 1)
+    n = write(w->fd, iov[0].iov_base, iov[0].iov_len);
+  else
+    n = writev(w->fd, iov, iovcnt);
+
+  if (f != NULL && ahead && (n >= 0 || errno == EAGAIN)) {
+    SAVE_ERRNO(uv__iou_write_submit(loop,
+                                    loop->iou,
+                                    w,
+                                    f,
+                                    iov,
+                                    iovcnt,
+                                    n < 0 ? 0 : n));
+  }
+
+  return n;
+}
+
+
+void uv__iou_poll(uv_loop_t* loop, int timeout) {
+  struct uv__io_uring_getevents_arg arg;
+  struct uv__kernel_timespec ts;
+  struct uv__iou* iou;
+  unsigned int flags;
+  unsigned int i;
+  uint64_t base;
+  uint64_t diff;
+  uv__io_t* w;
+  QUEUE* q;
+  int nevents;
+  int r;
+
+  iou = loop->iou;
+  iou->nready = 0;
+
+  if (iou->ndeferred != 0) {
+    uv__iou_queue_deferred(loop, iou);
+    if (iou->ndeferred != 0)
+      timeout = 0;
+  }
+
+  while (!QUEUE_EMPTY(&loop->watcher_queue)) {
+    q = QUEUE_HEAD(&loop->watcher_queue);
+    QUEUE_REMOVE(q);
+    QUEUE_INIT(q);
+
+    w = QUEUE_DATA(q, uv__io_t, watcher_queue);
+    assert(w->pevents != 0);
+    assert(w->fd >= 0);
+    assert(w->fd < (int) loop->nwatchers);
+
+    if (uv__iou_poll_arm(loop, iou, w)) {
+      /* Out of submission slots, try again after the next round. */
+      QUEUE_INSERT_HEAD(&loop->watcher_queue, q);
+      timeout = 0;
+      break;
+    }
+  }
+
+  /* Results that came in while the watchers weren't interested, e.g. data
+   * that was read ahead before uv_read_stop().
+   */
+  nevents = 0;
+  for (i = 0; i < iou->nready; i++)
+    nevents += uv__iou_dispatch(loop, iou, iou->ready[i]);
+
+  if (nevents != 0)
+    timeout = 0;
+
+  if (loop->nfds == 0 && iou->in_flight == 0) {
+    uv__iou_flush(loop);
+    return;
+  }
+
+  /* Don't wait when there's something to reap already. */
+  if (*iou->cqhead != ACCESS_ONCE(uint32_t, *iou->cqtail))
+    timeout = 0;
+
+  assert(timeout >= -1);
+  base = loop->time;
+
+  for (;;) {
+    memset(&arg, 0, sizeof(arg));
+    flags = UV__IORING_ENTER_EXT_ARG;
+    if (timeout != 0)
+      flags |= UV__IORING_ENTER_GETEVENTS;
+    if (timeout > 0) {
+      ts.tv_sec = timeout / 1000;
+      ts.tv_nsec = (timeout % 1000) * 1000000;
+      arg.ts = (uintptr_t) &ts;
+    }
+
+    r = uv__io_uring_enter(iou->ringfd,
+                           iou->unsubmitted,
+                           timeout != 0,
+                           flags,
+                           &arg,
+                           sizeof(arg));
+
+    if (r == -1 && errno != EINTR && errno != ETIME &&
+        errno != EAGAIN && errno != EBUSY)
+      abort();
+
+    iou->unsubmitted = *iou->sqtail - ACCESS_ONCE(uint32_t, *iou->sqhead);
+
+    /* Update loop->time unconditionally, see uv__io_poll(). */
+    SAVE_ERRNO(uv__update_time(loop));
+
+    nevents = uv__iou_reap(loop, iou);
+    if (nevents != 0 || timeout == 0)
+      return;
+
+    if (timeout == -1)
+      continue;
+
+    assert(timeout > 0);
+
+    diff = loop->time - base;
+    if (diff >= (uint64_t) timeout)
+      return;
+
+    timeout -= diff;
+    base = loop->time;
+  }
+}
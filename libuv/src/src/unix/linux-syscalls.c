@@ -229,6 +229,40 @@
 # endif
 #endif /* __NR_pwritev */
 
+#ifndef __NR_splice
+# if defined(__x86_64__)
+#  define __NR_splice 275
+# elif defined(__i386__)
+#  define __NR_splice 313
+# elif defined(__arm__)
+#  define __NR_splice (UV_SYSCALL_BASE + 340)
+# endif
+#endif /* __NR_splice */
+
+#ifndef __NR_io_uring_setup
+# if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+#  define __NR_io_uring_setup 425
+# elif defined(__arm__)
+#  define __NR_io_uring_setup (UV_SYSCALL_BASE + 425)
+# endif
+#endif /* __NR_io_uring_setup */
+
+#ifndef __NR_io_uring_enter
+# if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+#  define __NR_io_uring_enter 426
+# elif defined(__arm__)
+#  define __NR_io_uring_enter (UV_SYSCALL_BASE + 426)
+# endif
+#endif /* __NR_io_uring_enter */
+
+#ifndef __NR_io_uring_register
+# if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+#  define __NR_io_uring_register 427
+# elif defined(__arm__)
+#  define __NR_io_uring_register (UV_SYSCALL_BASE + 427)
+# endif
+#endif /* __NR_io_uring_register */
+
 
 int uv__accept4(int fd, struct sockaddr* addr, socklen_t* addrlen, int flags) {
 #if defined(__i386__)
@@ -443,3 +477,58 @@ int uv__dup3(int oldfd, int newfd, int flags) {
   return errno = ENOSYS, -1;
 #endif
 }
+
+
+ssize_t uv__splice(int fd_in,
+                   off_t* off_in,
+                   int fd_out,
+                   off_t* off_out,
+                   size_t len,
+                   unsigned int flags) {
+#if defined(__NR_splice)
+  return syscall(__NR_splice, fd_in, off_in, fd_out, off_out, len, flags);
+#else
+  return errno = ENOSYS, -1;
+#endif
+}
+
+
+int uv__io_uring_setup(unsigned int entries, struct uv__io_uring_params* p) {
+#if defined(__NR_io_uring_setup)
+  return syscall(__NR_io_uring_setup, entries, p);
+#else
+  return errno = ENOSYS, -1;
+#endif
+}
+
+
+int uv__io_uring_enter(int fd,
+                       unsigned int to_submit,
+                       unsigned int min_complete,
+                       unsigned int flags,
+                       void* arg,
+                       size_t argsz) {
+#if defined(__NR_io_uring_enter)
+  return syscall(__NR_io_uring_enter,
+                 fd,
+                 to_submit,
+                 min_complete,
+                 flags,
+                 arg,
+                 argsz);
+#else
+  return errno = ENOSYS, -1;
+#endif
+}
+
+
+int uv__io_uring_register(int fd,
+                          unsigned int opcode,
+                          void* arg,
+                          unsigned int nargs) {
+#if defined(__NR_io_uring_register)
+  return syscall(__NR_io_uring_register, fd, opcode, arg, nargs);
+#else
+  return errno = ENOSYS, -1;
+#endif
+}
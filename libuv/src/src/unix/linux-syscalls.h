@@ -72,9 +72,21 @@
 #define UV__EPOLLOUT          4
 #define UV__EPOLLERR          8
 #define UV__EPOLLHUP          16
+#define UV__EPOLLRDHUP        0x2000
+#define UV__EPOLLEXCLUSIVE    0x10000000
 #define UV__EPOLLONESHOT      0x40000000
 #define UV__EPOLLET           0x80000000
 
+/* MSG_ZEROCOPY */
+#define UV__SO_ZEROCOPY             60
+#define UV__MSG_ZEROCOPY            0x4000000
+#define UV__SO_EE_ORIGIN_ZEROCOPY   5
+
+/* splice flags */
+#define UV__SPLICE_F_MOVE           1
+#define UV__SPLICE_F_NONBLOCK       2
+#define UV__SPLICE_F_MORE           4
+
 /* inotify flags */
 #define UV__IN_ACCESS         0x001
 #define UV__IN_MODIFY         0x002
@@ -109,11 +121,183 @@ struct uv__inotify_event {
   /* char name[0]; */
 };
 
+struct uv__sock_extended_err {
+  uint32_t ee_errno;
+  uint8_t ee_origin;
+  uint8_t ee_type;
+  uint8_t ee_code;
+  uint8_t ee_pad;
+  uint32_t ee_info;
+  uint32_t ee_data;
+};
+
 struct uv__mmsghdr {
   struct msghdr msg_hdr;
   unsigned int msg_len;
 };
 
+/* io_uring */
+#define UV__IORING_OP_READV           1
+#define UV__IORING_OP_WRITEV          2
+#define UV__IORING_OP_FSYNC           3
+#define UV__IORING_OP_POLL_ADD        6
+#define UV__IORING_OP_POLL_REMOVE     7
+#define UV__IORING_OP_ACCEPT          13
+#define UV__IORING_OP_ASYNC_CANCEL    14
+#define UV__IORING_OP_OPENAT          18
+#define UV__IORING_OP_CLOSE           19
+#define UV__IORING_OP_STATX           21
+#define UV__IORING_OP_READ            22
+#define UV__IORING_OP_WRITE           23
+
+#define UV__IORING_FSYNC_DATASYNC     1
+
+#define UV__IOSQE_BUFFER_SELECT       32
+
+#define UV__IORING_CQE_F_BUFFER       1
+#define UV__IORING_CQE_BUFFER_SHIFT   16
+
+#define UV__IORING_ENTER_GETEVENTS    1
+#define UV__IORING_ENTER_EXT_ARG      8
+
+#define UV__IORING_FEAT_SINGLE_MMAP   1
+#define UV__IORING_FEAT_NODROP        2
+#define UV__IORING_FEAT_RW_CUR_POS    8
+#define UV__IORING_FEAT_POLL_32BITS   64
+#define UV__IORING_FEAT_EXT_ARG       256
+
+#define UV__IORING_OFF_SQ_RING        0
+#define UV__IORING_OFF_CQ_RING        0x8000000
+#define UV__IORING_OFF_SQES           0x10000000
+
+#define UV__IORING_REGISTER_PBUF_RING 22
+
+struct uv__io_uring_sqe {
+  uint8_t opcode;
+  uint8_t flags;
+  uint16_t ioprio;
+  int32_t fd;
+  uint64_t off;       /* Also addr2. */
+  uint64_t addr;
+  uint32_t len;
+  uint32_t op_flags;  /* rw_flags, fsync_flags, open_flags, statx_flags... */
+  uint64_t user_data;
+  uint16_t buf_group;  /* Also buf_index. */
+  uint16_t personality;
+  int32_t splice_fd_in;
+  uint64_t pad[2];
+};
+
+struct uv__io_uring_cqe {
+  uint64_t user_data;
+  int32_t res;
+  uint32_t flags;
+};
+
+/* An entry of a provided buffer ring. The ring's tail is the resv field of
+ * the first entry.
+ */
+struct uv__io_uring_buf {
+  uint64_t addr;
+  uint32_t len;
+  uint16_t bid;
+  uint16_t resv;
+};
+
+struct uv__io_uring_buf_reg {
+  uint64_t ring_addr;
+  uint32_t ring_entries;
+  uint16_t bgid;
+  uint16_t flags;
+  uint64_t resv[3];
+};
+
+struct uv__io_sqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t flags;
+  uint32_t dropped;
+  uint32_t array;
+  uint32_t reserved0;
+  uint64_t reserved1;
+};
+
+struct uv__io_cqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t overflow;
+  uint32_t cqes;
+  uint32_t flags;
+  uint32_t reserved0;
+  uint64_t reserved1;
+};
+
+struct uv__io_uring_getevents_arg {
+  uint64_t sigmask;
+  uint32_t sigmask_sz;
+  uint32_t pad;
+  uint64_t ts;
+};
+
+struct uv__kernel_timespec {
+  int64_t tv_sec;
+  int64_t tv_nsec;
+};
+
+struct uv__io_uring_params {
+  uint32_t sq_entries;
+  uint32_t cq_entries;
+  uint32_t flags;
+  uint32_t sq_thread_cpu;
+  uint32_t sq_thread_idle;
+  uint32_t features;
+  uint32_t wq_fd;
+  uint32_t reserved[3];
+  struct uv__io_sqring_offsets sq_off;
+  struct uv__io_cqring_offsets cq_off;
+};
+
+/* statx */
+#define UV__STATX_BASIC_STATS         0x7ff
+
+#define UV__AT_FDCWD                  -100
+#define UV__AT_SYMLINK_NOFOLLOW       0x100
+#define UV__AT_EMPTY_PATH             0x1000
+
+struct uv__statx_timestamp {
+  int64_t tv_sec;
+  uint32_t tv_nsec;
+  int32_t reserved;
+};
+
+struct uv__statx {
+  uint32_t stx_mask;
+  uint32_t stx_blksize;
+  uint64_t stx_attributes;
+  uint32_t stx_nlink;
+  uint32_t stx_uid;
+  uint32_t stx_gid;
+  uint16_t stx_mode;
+  uint16_t unused0;
+  uint64_t stx_ino;
+  uint64_t stx_size;
+  uint64_t stx_blocks;
+  uint64_t stx_attributes_mask;
+  struct uv__statx_timestamp stx_atime;
+  struct uv__statx_timestamp stx_btime;
+  struct uv__statx_timestamp stx_ctime;
+  struct uv__statx_timestamp stx_mtime;
+  uint32_t stx_rdev_major;
+  uint32_t stx_rdev_minor;
+  uint32_t stx_dev_major;
+  uint32_t stx_dev_minor;
+  uint64_t unused1[14];
+};
+
 int uv__accept4(int fd, struct sockaddr* addr, socklen_t* addrlen, int flags);
 int uv__eventfd(unsigned int count);
 int uv__epoll_create(int size);
@@ -150,5 +334,22 @@ int uv__utimesat(int dirfd,
 ssize_t uv__preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
 ssize_t uv__pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
 int uv__dup3(int oldfd, int newfd, int flags);
+ssize_t uv__splice(int fd_in,
+                   off_t* off_in,
+                   int fd_out,
+                   off_t* off_out,
+                   size_t len,
+                   unsigned int flags);
+int uv__io_uring_setup(unsigned int entries, struct uv__io_uring_params* p);
+int uv__io_uring_enter(int fd,
+                       unsigned int to_submit,
+                       unsigned int min_complete,
+                       unsigned int flags,
+                       void* arg,
+                       size_t argsz);
+int uv__io_uring_register(int fd,
+                          unsigned int opcode,
+                          void* arg,
+                          unsigned int nargs);
 
 #endif /* UV_LINUX_SYSCALL_H_ */
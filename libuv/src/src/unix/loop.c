@@ -106,13 +106,15 @@ static int uv__loop_init(uv_loop_t* loop, int default_loop) {
 
   memset(loop, 0, sizeof(*loop));
   heap_init((struct heap*) &loop->timer_heap);
-  QUEUE_INIT(&loop->wq);
+  loop->wq = NULL;
+  QUEUE_INIT(&loop->wq_batch);
   QUEUE_INIT(&loop->active_reqs);
   QUEUE_INIT(&loop->idle_handles);
   QUEUE_INIT(&loop->async_handles);
   QUEUE_INIT(&loop->check_handles);
   QUEUE_INIT(&loop->prepare_handles);
   QUEUE_INIT(&loop->handle_queue);
+  QUEUE_INIT(&loop->flush_queue);
 
   loop->nfds = 0;
   loop->watchers = NULL;
@@ -129,6 +131,9 @@ static int uv__loop_init(uv_loop_t* loop, int default_loop) {
   loop->emfile_fd = -1;
 
   loop->timer_counter = 0;
+  loop->timer_wheel = NULL;
+  loop->timer_slack = 0;
+  loop->read_pool = NULL;
   loop->stop_flag = 0;
 
   err = uv__platform_loop_init(loop, default_loop);
@@ -145,8 +150,7 @@ static int uv__loop_init(uv_loop_t* loop, int default_loop) {
   if (uv_rwlock_init(&loop->cloexec_lock))
     abort();
 
-  if (uv_mutex_init(&loop->wq_mutex))
-    abort();
+  loop->wq_stats = NULL;
 
   if (uv_async_init(loop, &loop->wq_async, uv__work_done))
     abort();
@@ -158,7 +162,50 @@ static int uv__loop_init(uv_loop_t* loop, int default_loop) {
 }
 
 
+int uv__loop_configure(uv_loop_t* loop, uv_loop_option option, va_list ap) {
+  switch (option) {
+  case UV_LOOP_EDGE_TRIGGERED:
+#if defined(__linux__)
+    if (loop->flags & UV_LOOP_IOURING_POLL)
+      return -EINVAL;
+    loop->flags |= UV_LOOP_EPOLLET;
+    return 0;
+#else
+    return -ENOSYS;
+#endif
+
+  case UV_LOOP_IO_URING:
+#if defined(__linux__)
+    return uv__iou_poll_init(loop);
+#else
+    return -ENOSYS;
+#endif
+
+  case UV_LOOP_THREADPOOL_STATS:
+    return uv__work_stats_init(loop);
+
+  case UV_LOOP_TIMER_WHEEL:
+    return uv__timer_wheel_init(loop);
+
+  case UV_LOOP_TIMER_SLACK:
+    loop->timer_slack = va_arg(ap, unsigned int);
+    return 0;
+
+  case UV_LOOP_READ_BUFFER_POOL:
+    return uv__read_pool_init(loop);
+
+  default:
+    return -EINVAL;
+  }
+}
+
+
 static void uv__loop_close(uv_loop_t* loop) {
+  /* A worker may still be about to uv_async_send() the loop, wait for it to
+   * finish before the wakeup file descriptor goes away.
+   */
+  uv__work_loop_close(loop);
+
   uv__signal_loop_cleanup(loop);
   uv__platform_loop_delete(loop);
   uv__async_stop(loop, &loop->async_watcher);
@@ -173,11 +220,10 @@ static void uv__loop_close(uv_loop_t* loop) {
     loop->backend_fd = -1;
   }
 
-  uv_mutex_lock(&loop->wq_mutex);
-  assert(QUEUE_EMPTY(&loop->wq) && "thread pool work queue not empty!");
+  assert(loop->wq == NULL && "thread pool work queue not empty!");
   assert(!uv__has_active_reqs(loop));
-  uv_mutex_unlock(&loop->wq_mutex);
-  uv_mutex_destroy(&loop->wq_mutex);
+  free(loop->wq_stats);
+  loop->wq_stats = NULL;
 
   /*
    * Note that all thread pool stuff is finished at this point and
@@ -194,4 +240,9 @@ static void uv__loop_close(uv_loop_t* loop) {
   free(loop->watchers);
   loop->watchers = NULL;
   loop->nwatchers = 0;
+
+  free(loop->timer_wheel);
+  loop->timer_wheel = NULL;
+
+  uv__read_pool_close(loop);
 }
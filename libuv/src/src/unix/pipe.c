@@ -111,6 +111,7 @@ int uv_pipe_listen(uv_pipe_t* handle, int backlog, uv_connection_cb cb) {
 
   handle->connection_cb = cb;
   handle->io_watcher.cb = uv__server_io;
+  uv__io_set_ring(&handle->io_watcher, UV__IO_RING_ACCEPT);
   uv__io_start(handle->loop, &handle->io_watcher, UV__POLLIN);
   return 0;
 }
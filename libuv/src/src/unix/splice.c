@@ -0,0 +1,429 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Stream to stream splicing.
+ *
+ * A splice owns the read side of its source and the write side of its
+ * destination: uv__stream_io() hands their events to uv__splice_io(). Data in
+ * flight sits in a kernel pipe when splice(2) works for both file descriptors,
+ * in splice->buf otherwise. splice->size is the number of bytes in either.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+/* The capacity of a pipe by default. */
+#define UV__SPLICE_SIZE 65536
+
+/* Read/write rounds per wakeup before other handles get a turn. */
+#define UV__SPLICE_ROUNDS 16
+
+/* uv_splice_t flags, next to the public UV_SPLICE_* flags. */
+enum {
+  UV__SPLICE_EOF  = 0x100,  /* Read EOF from the source. */
+  UV__SPLICE_FULL = 0x200   /* The kernel pipe ran out of slots. */
+};
+
+
+static int uv__splice_stream_ok(const uv_stream_t* stream) {
+  if (stream->type == UV_TCP)
+    return 1;
+
+  if (stream->type == UV_NAMED_PIPE)
+    return !((const uv_pipe_t*) stream)->ipc;
+
+  return 0;
+}
+
+
+static void uv__splice_detach(uv_splice_t* splice) {
+  uv_stream_t* source;
+  uv_stream_t* dest;
+
+  source = splice->source;
+  dest = splice->dest;
+
+  source->splice[0] = NULL;
+  dest->splice[1] = NULL;
+
+  uv__io_stop(splice->loop, &source->io_watcher, UV__POLLIN);
+  uv__io_stop(splice->loop, &dest->io_watcher, UV__POLLOUT);
+
+  /* The other direction of a relay may still be using them. */
+  if (!uv__io_active(&source->io_watcher, UV__POLLIN | UV__POLLOUT))
+    uv__handle_stop(source);
+  if (!uv__io_active(&dest->io_watcher, UV__POLLIN | UV__POLLOUT))
+    uv__handle_stop(dest);
+
+  if (splice->fds[0] != -1) {
+    uv__close(splice->fds[0]);
+    uv__close(splice->fds[1]);
+    splice->fds[0] = -1;
+    splice->fds[1] = -1;
+  }
+
+  free(splice->buf);
+  splice->buf = NULL;
+}
+
+
+static void uv__splice_finish(uv_splice_t* splice, int status) {
+  uv__splice_detach(splice);
+
+  if (splice->cb != NULL)
+    splice->cb(splice, status);
+}
+
+
+/* Switches to copying through splice->buf, taking along what's already in the
+ * kernel pipe.
+ */
+static int uv__splice_copy_mode(uv_splice_t* splice) {
+  size_t nread;
+  ssize_t r;
+  char* buf;
+
+  buf = malloc(UV__SPLICE_SIZE);
+  if (buf == NULL)
+    return -ENOMEM;
+
+  for (nread = 0; nread < splice->size; nread += r) {
+    do
+      r = read(splice->fds[0], buf + nread, splice->size - nread);
+    while (r == -1 && errno == EINTR);
+
+    if (r <= 0) {
+      free(buf);
+      return r == 0 ? -EIO : -errno;
+    }
+  }
+
+  uv__close(splice->fds[0]);
+  uv__close(splice->fds[1]);
+  splice->fds[0] = -1;
+  splice->fds[1] = -1;
+  splice->buf = buf;
+  splice->offset = 0;
+
+  return 0;
+}
+
+
+static ssize_t uv__splice_read(uv_splice_t* splice) {
+  size_t space;
+  ssize_t r;
+  int fd;
+
+  fd = uv__stream_fd(splice->source);
+  space = UV__SPLICE_SIZE - splice->size;
+
+#if defined(__linux__)
+  if (splice->fds[0] != -1) {
+    int err;
+
+    do
+      r = uv__splice(fd,
+                     NULL,
+                     splice->fds[1],
+                     NULL,
+                     space,
+                     UV__SPLICE_F_MOVE | UV__SPLICE_F_NONBLOCK);
+    while (r == -1 && errno == EINTR);
+
+    if (r != -1 || (errno != EINVAL && errno != ENOSYS))
+      return r;
+
+    err = uv__splice_copy_mode(splice);
+    if (err)
+      return errno = -err, -1;
+  }
+#endif
+
+  if (splice->offset > 0) {
+    memmove(splice->buf, splice->buf + splice->offset, splice->size);
+    splice->offset = 0;
+  }
+
+  do
+#if defined(__linux__)
+    r = uv__iou_read(splice->loop,
+                     &splice->source->io_watcher,
+                     splice->buf + splice->size,
+                     space);
+#else
+    r = read(fd, splice->buf + splice->size, space);
+#endif
+  while (r == -1 && errno == EINTR);
+
+  return r;
+}
+
+
+static ssize_t uv__splice_write(uv_splice_t* splice) {
+  ssize_t r;
+  int fd;
+
+  fd = uv__stream_fd(splice->dest);
+
+#if defined(__linux__)
+  if (splice->fds[0] != -1) {
+    int err;
+
+    do
+      r = uv__splice(splice->fds[0],
+                     NULL,
+                     fd,
+                     NULL,
+                     splice->size,
+                     UV__SPLICE_F_MOVE | UV__SPLICE_F_NONBLOCK);
+    while (r == -1 && errno == EINTR);
+
+    if (r != -1 || (errno != EINVAL && errno != ENOSYS))
+      return r;
+
+    err = uv__splice_copy_mode(splice);
+    if (err)
+      return errno = -err, -1;
+  }
+#endif
+
+  do
+    r = write(fd, splice->buf + splice->offset, splice->size);
+  while (r == -1 && errno == EINTR);
+
+  return r;
+}
+
+
+static void uv__splice_run(uv_splice_t* splice) {
+  uv_stream_t* source;
+  uv_stream_t* dest;
+  unsigned int rounds;
+  int progress;
+  ssize_t r;
+  int err;
+
+  source = splice->source;
+  dest = splice->dest;
+
+  for (rounds = 0; rounds < UV__SPLICE_ROUNDS; rounds++) {
+    progress = 0;
+
+    if (splice->size > 0) {
+      r = uv__splice_write(splice);
+
+      if (r > 0) {
+        splice->size -= r;
+        splice->offset += r;
+        splice->bytes_written += r;
+        splice->flags &= ~UV__SPLICE_FULL;
+        progress = 1;
+      } else if (r == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        uv__io_drained(&dest->io_watcher, UV__POLLOUT);
+      } else {
+        uv__splice_finish(splice, r == -1 ? -errno : -EIO);
+        return;
+      }
+
+      if (splice->size == 0)
+        splice->offset = 0;
+    }
+
+    if (!(splice->flags & (UV__SPLICE_EOF | UV__SPLICE_FULL)) &&
+        splice->size < UV__SPLICE_SIZE) {
+      r = uv__splice_read(splice);
+
+      if (r > 0) {
+        splice->size += r;
+        splice->bytes_read += r;
+        progress = 1;
+      } else if (r == 0) {
+        splice->flags |= UV__SPLICE_EOF;
+        progress = 1;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        /* A kernel pipe can run out of slots before it runs out of bytes,
+         * wait for the destination to make room.
+         */
+        if (splice->fds[0] != -1 && splice->size > 0)
+          splice->flags |= UV__SPLICE_FULL;
+        else
+          uv__io_drained(&source->io_watcher, UV__POLLIN);
+      } else {
+        uv__splice_finish(splice, -errno);
+        return;
+      }
+    }
+
+    if (!progress)
+      break;
+  }
+
+  /* Out of rounds, the ends didn't see EAGAIN. */
+  if (rounds == UV__SPLICE_ROUNDS) {
+    uv__io_requeue(splice->loop, &source->io_watcher);
+    uv__io_requeue(splice->loop, &dest->io_watcher);
+  }
+
+  if ((splice->flags & UV__SPLICE_EOF) && splice->size == 0) {
+    err = 0;
+    if (splice->flags & UV_SPLICE_SHUTDOWN) {
+      if (shutdown(uv__stream_fd(dest), SHUT_WR))
+        err = -errno;
+      else
+        dest->flags |= UV_STREAM_SHUT;
+    }
+
+    uv__splice_finish(splice, err);
+    return;
+  }
+
+  if (!(splice->flags & (UV__SPLICE_EOF | UV__SPLICE_FULL)) &&
+      splice->size < UV__SPLICE_SIZE) {
+    uv__io_start(splice->loop, &source->io_watcher, UV__POLLIN);
+  } else {
+    uv__io_stop(splice->loop, &source->io_watcher, UV__POLLIN);
+  }
+
+  if (splice->size > 0)
+    uv__io_start(splice->loop, &dest->io_watcher, UV__POLLOUT);
+  else
+    uv__io_stop(splice->loop, &dest->io_watcher, UV__POLLOUT);
+}
+
+
+void uv__splice_io(uv_stream_t* stream, unsigned int events) {
+  if (stream->splice[0] != NULL &&
+      (events & (UV__POLLIN | UV__POLLERR | UV__POLLHUP))) {
+    uv__splice_run(stream->splice[0]);
+  }
+
+  /* The callback may have stopped the other direction or closed the stream. */
+  if (stream->splice[1] != NULL &&
+      (events & (UV__POLLOUT | UV__POLLERR | UV__POLLHUP))) {
+    uv__splice_run(stream->splice[1]);
+  }
+}
+
+
+void uv__splice_close(uv_stream_t* stream) {
+  if (stream->splice[0] != NULL)
+    uv__splice_detach(stream->splice[0]);
+
+  if (stream->splice[1] != NULL)
+    uv__splice_detach(stream->splice[1]);
+}
+
+
+int uv_splice_start(uv_loop_t* loop,
+                    uv_splice_t* splice,
+                    uv_stream_t* source,
+                    uv_stream_t* dest,
+                    unsigned int flags,
+                    uv_splice_cb cb) {
+  if (flags & ~UV_SPLICE_SHUTDOWN)
+    return -EINVAL;
+
+  if (source == dest ||
+      !uv__splice_stream_ok(source) ||
+      !uv__splice_stream_ok(dest)) {
+    return -EINVAL;
+  }
+
+  if (uv__stream_fd(source) == -1 ||
+      uv__stream_fd(dest) == -1 ||
+      source->connect_req != NULL ||
+      dest->connect_req != NULL ||
+      !(source->flags & UV_STREAM_READABLE) ||
+      !(dest->flags & UV_STREAM_WRITABLE) ||
+      (dest->flags & (UV_STREAM_SHUTTING | UV_STREAM_SHUT)) ||
+      ((source->flags | dest->flags) & UV_CLOSING)) {
+    return -EINVAL;
+  }
+
+  /* uv__stream_io() hands every event of a spliced stream to the splice,
+   * nothing would service reads or writes of the user on either stream.
+   */
+  if (source->splice[0] != NULL ||
+      dest->splice[1] != NULL ||
+      ((source->flags | dest->flags) & UV_STREAM_READING) ||
+      !QUEUE_EMPTY(&source->write_queue) ||
+      !QUEUE_EMPTY(&dest->write_queue) ||
+      source->shutdown_req != NULL ||
+      dest->shutdown_req != NULL) {
+    return -EBUSY;
+  }
+
+  splice->fds[0] = -1;
+  splice->fds[1] = -1;
+  splice->buf = NULL;
+
+#if defined(__linux__)
+  /* Copy instead when out of file descriptors, or when the io_uring read
+   * ahead for the source, that data has to go first.
+   */
+  uv__io_clear_ring(&source->io_watcher, UV__IO_RING_READ);
+  if (uv__iou_read_ahead(loop, &source->io_watcher) ||
+      uv__make_pipe(splice->fds, UV__F_NONBLOCK)) {
+    splice->fds[0] = -1;
+    splice->fds[1] = -1;
+  }
+#endif
+
+  if (splice->fds[0] == -1) {
+    splice->buf = malloc(UV__SPLICE_SIZE);
+    if (splice->buf == NULL)
+      return -ENOMEM;
+  }
+
+  splice->loop = loop;
+  splice->source = source;
+  splice->dest = dest;
+  splice->bytes_read = 0;
+  splice->bytes_written = 0;
+  splice->cb = cb;
+  splice->offset = 0;
+  splice->size = 0;
+  splice->flags = flags;
+
+  source->splice[0] = splice;
+  dest->splice[1] = splice;
+
+  uv__handle_start(source);
+  uv__handle_start(dest);
+  uv__io_start(loop, &source->io_watcher, UV__POLLIN);
+
+  return 0;
+}
+
+
+int uv_splice_stop(uv_splice_t* splice) {
+  if (splice->source->splice[0] == splice)
+    uv__splice_detach(splice);
+
+  return 0;
+}
@@ -32,9 +32,14 @@
 #include <sys/socket.h>
 #include <sys/uio.h>
 #include <sys/un.h>
+#include <netinet/in.h>
 #include <unistd.h>
 #include <limits.h> /* IOV_MAX */
 
+#if defined(__linux__) || defined(__sun)
+# include <sys/sendfile.h>
+#endif
+
 #if defined(__APPLE__)
 # include <sys/event.h>
 # include <sys/time.h>
@@ -62,6 +67,10 @@ static void uv__read(uv_stream_t* stream);
 static void uv__stream_io(uv_loop_t* loop, uv__io_t* w, unsigned int events);
 static void uv__write_callbacks(uv_stream_t* stream);
 static size_t uv__write_req_size(uv_write_t* req);
+static void uv__write_queue(uv_stream_t* stream,
+                            uv_write_t* req,
+                            int empty_queue);
+void uv_try_write_cb(uv_write_t* req, int status);
 
 
 void uv__stream_init(uv_loop_t* loop,
@@ -78,7 +87,14 @@ void uv__stream_init(uv_loop_t* loop,
   stream->shutdown_req = NULL;
   stream->accepted_fd = -1;
   stream->queued_fds = NULL;
+  stream->splice[0] = NULL;
+  stream->splice[1] = NULL;
   stream->delayed_error = 0;
+  stream->watermark_cb = NULL;
+  stream->frame = NULL;
+  stream->write_high = 0;
+  stream->write_low = 0;
+  QUEUE_INIT(&stream->flush_queue);
   QUEUE_INIT(&stream->write_queue);
   QUEUE_INIT(&stream->write_completed_queue);
   stream->write_queue_size = 0;
@@ -94,6 +110,10 @@ void uv__stream_init(uv_loop_t* loop,
 #endif /* defined(__APPLE_) */
 
   uv__io_init(&stream->io_watcher, uv__stream_io, -1);
+
+  /* A partial read() from a TTY doesn't mean there's no more input. */
+  if (type != UV_TTY)
+    uv__io_set_edge(&stream->io_watcher);
 }
 
 
@@ -350,6 +370,14 @@ int uv__stream_open(uv_stream_t* stream, int fd, int flags) {
     if ((stream->flags & UV_TCP_NODELAY) && uv__tcp_nodelay(fd, 1))
       return -errno;
 
+    if ((stream->flags & UV_TCP_ZEROCOPY) && uv__tcp_zerocopy(fd, 1))
+      return -errno;
+
+    if (((uv_tcp_t*) stream)->notsent_lowat != 0 &&
+        uv__tcp_notsent_lowat(fd, ((uv_tcp_t*) stream)->notsent_lowat)) {
+      return -errno;
+    }
+
     /* TODO Use delay the user passed in. */
     if ((stream->flags & UV_TCP_KEEPALIVE) && uv__tcp_keepalive(fd, 1, 60))
       return -errno;
@@ -374,6 +402,9 @@ void uv__stream_destroy(uv_stream_t* stream) {
     stream->connect_req = NULL;
   }
 
+  if (stream->type == UV_TCP)
+    uv__connect_host_cancel((uv_tcp_t*) stream);
+
   while (!QUEUE_EMPTY(&stream->write_queue)) {
     q = QUEUE_HEAD(&stream->write_queue);
     QUEUE_REMOVE(q);
@@ -384,7 +415,32 @@ void uv__stream_destroy(uv_stream_t* stream) {
     QUEUE_INSERT_TAIL(&stream->write_completed_queue, &req->queue);
   }
 
+#if defined(__linux__)
+  /* Sent with MSG_ZEROCOPY but the kernel hasn't released the pages yet and
+   * with the socket gone it won't tell us when it does. Don't pretend the
+   * buffers are free again, see uv_tcp_zerocopy(). The requests that only
+   * waited behind them are done.
+   */
+  if (stream->type == UV_TCP) {
+    uv_tcp_t* tcp = (uv_tcp_t*) stream;
+
+    while (!QUEUE_EMPTY(&tcp->zerocopy_queue)) {
+      q = QUEUE_HEAD(&tcp->zerocopy_queue);
+      QUEUE_REMOVE(q);
+
+      req = QUEUE_DATA(q, uv_write_t, queue);
+      if (req->error == 0 && req->zerocopy_done != req->zerocopy_sent)
+        req->error = -ECANCELED;
+
+      QUEUE_INSERT_TAIL(&stream->write_completed_queue, &req->queue);
+    }
+
+    tcp->zerocopy_pending = 0;
+  }
+#endif
+
   uv__write_callbacks(stream);
+  uv__frame_free(stream);
 
   if (stream->shutdown_req) {
     /* The ECANCELED error code is a lie, the shutdown(2) syscall is a
@@ -412,7 +468,7 @@ void uv__stream_destroy(uv_stream_t* stream) {
  * thread opens a file or creates a socket in the time window between us
  * calling close() and accept().
  */
-static int uv__emfile_trick(uv_loop_t* loop, int accept_fd) {
+int uv__emfile_trick(uv_loop_t* loop, int accept_fd) {
   int err;
   int emfile_fd;
 
@@ -465,18 +521,26 @@ void uv__server_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
       return;
 #endif /* defined(UV_HAVE_KQUEUE) */
 
+#if defined(__linux__)
+    err = uv__iou_accept(loop, w);
+#else
     err = uv__accept(uv__stream_fd(stream));
+#endif
     if (err < 0) {
-      if (err == -EAGAIN || err == -EWOULDBLOCK)
+      if (err == -EAGAIN || err == -EWOULDBLOCK) {
+        uv__io_drained(w, UV__POLLIN);
         return;  /* Not an error. */
+      }
 
       if (err == -ECONNABORTED)
         continue;  /* Ignore. Nothing we can do about that. */
 
       if (err == -EMFILE || err == -ENFILE) {
         err = uv__emfile_trick(loop, uv__stream_fd(stream));
-        if (err == -EAGAIN || err == -EWOULDBLOCK)
+        if (err == -EAGAIN || err == -EWOULDBLOCK) {
+          uv__io_drained(w, UV__POLLIN);
           break;
+        }
       }
 
       stream->connection_cb(stream, err);
@@ -601,6 +665,16 @@ static void uv__drain(uv_stream_t* stream) {
   uv__io_stop(stream->loop, &stream->io_watcher, UV__POLLOUT);
   uv__stream_osx_interrupt_select(stream);
 
+#if defined(__linux__)
+  /* Not before the last write callback, uv__stream_io() calls us again when
+   * the kernel released the buffers of the zero-copy sends.
+   */
+  if (stream->type == UV_TCP &&
+      !QUEUE_EMPTY(&((uv_tcp_t*) stream)->zerocopy_queue)) {
+    return;
+  }
+#endif
+
   /* Shutdown? */
   if ((stream->flags & UV_STREAM_SHUTTING) &&
       !(stream->flags & UV_CLOSING) &&
@@ -655,6 +729,19 @@ static void uv__write_req_finish(uv_write_t* req) {
     req->bufs = NULL;
   }
 
+#if defined(__linux__)
+  /* Zero-copy sends are complete when the kernel releases the buffers, see
+   * uv__stream_zerocopy_reap(). Later requests wait behind them so that the
+   * write callbacks run in order.
+   */
+  if (stream->type == UV_TCP &&
+      (!QUEUE_EMPTY(&((uv_tcp_t*) stream)->zerocopy_queue) ||
+       (req->error == 0 && req->zerocopy_done != req->zerocopy_sent))) {
+    QUEUE_INSERT_TAIL(&((uv_tcp_t*) stream)->zerocopy_queue, &req->queue);
+    return;
+  }
+#endif
+
   /* Add it to the write_completed_queue where it will have its
    * callback called in the near future.
    */
@@ -690,7 +777,403 @@ static int uv__getiovmax() {
 #endif
 }
 
+#if defined(__linux__)
+static int uv__write_zerocopy_ok(uv_stream_t* stream, uv_write_t* req) {
+  if (stream->type != UV_TCP || !(stream->flags & UV_TCP_ZEROCOPY))
+    return 0;
+
+  /* uv_try_write() doesn't wait for the kernel to release the buffers. */
+  if (req->cb == uv_try_write_cb)
+    return 0;
+
+  return uv__write_req_size(req) >= ((uv_tcp_t*) stream)->zerocopy_threshold;
+}
+
+
+static ssize_t uv__write_zerocopy(uv_stream_t* stream,
+                                  uv_write_t* req,
+                                  struct iovec* iov,
+                                  int iovcnt) {
+  uv_tcp_t* tcp;
+  struct msghdr msg;
+  ssize_t n;
+
+  tcp = (uv_tcp_t*) stream;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = iovcnt;
+
+  do
+    n = sendmsg(uv__stream_fd(stream), &msg, UV__MSG_ZEROCOPY);
+  while (n == -1 && errno == EINTR);
+
+  /* Out of option memory to track the pages, copy this one. */
+  if (n == -1 && errno == ENOBUFS) {
+    do
+      n = writev(uv__stream_fd(stream), iov, iovcnt);
+    while (n == -1 && errno == EINTR);
+    return n;
+  }
+
+  if (n <= 0)
+    return n;
+
+  /* The kernel numbers successful zero-copy sends per socket, from zero.
+   * The sends of a request are consecutive.
+   */
+  if (req->zerocopy_sent == 0)
+    req->zerocopy_first = tcp->zerocopy_next;
+  req->zerocopy_sent++;
+  tcp->zerocopy_next++;
+  tcp->zerocopy_pending++;
+
+  /* Completions arrive on the error queue, keep watching after the write
+   * queue drains.
+   */
+  uv__io_start(stream->loop, &stream->io_watcher, UV__POLLERR);
+
+  return n;
+}
+
+
+/* Counts the sends of `req` that fall within the completed range [lo, hi].
+ * Sequence numbers wrap around, compare distances.
+ */
+static void uv__write_zerocopy_done(uv_write_t* req,
+                                    unsigned int lo,
+                                    unsigned int hi) {
+  unsigned int start;
+  unsigned int end;
+
+  if (req->zerocopy_sent == 0)
+    return;
+
+  start = req->zerocopy_first;
+  if ((int) (lo - start) > 0)
+    start = lo;
+
+  end = req->zerocopy_first + req->zerocopy_sent;
+  if ((int) (hi + 1 - end) < 0)
+    end = hi + 1;
+
+  if ((int) (end - start) > 0)
+    req->zerocopy_done += end - start;
+}
+
+
+static void uv__stream_zerocopy_release(uv_stream_t* stream,
+                                        unsigned int lo,
+                                        unsigned int hi) {
+  uv_write_t* req;
+  uv_tcp_t* tcp;
+  QUEUE* q;
+
+  tcp = (uv_tcp_t*) stream;
+  tcp->zerocopy_pending -= hi - lo + 1;
+
+  /* The request that's being written may have sends in the range too. */
+  if (!QUEUE_EMPTY(&stream->write_queue)) {
+    q = QUEUE_HEAD(&stream->write_queue);
+    uv__write_zerocopy_done(QUEUE_DATA(q, uv_write_t, queue), lo, hi);
+  }
+
+  QUEUE_FOREACH(q, &tcp->zerocopy_queue)
+    uv__write_zerocopy_done(QUEUE_DATA(q, uv_write_t, queue), lo, hi);
+
+  /* In order, up to the first request the kernel still has pages of. */
+  while (!QUEUE_EMPTY(&tcp->zerocopy_queue)) {
+    q = QUEUE_HEAD(&tcp->zerocopy_queue);
+    req = QUEUE_DATA(q, uv_write_t, queue);
+    if (req->error == 0 && req->zerocopy_done != req->zerocopy_sent)
+      break;
+
+    QUEUE_REMOVE(q);
+    QUEUE_INSERT_TAIL(&stream->write_completed_queue, q);
+  }
+}
+
+
+/* Reads MSG_ZEROCOPY completions off the socket error queue and moves the
+ * requests whose buffers the kernel has released to write_completed_queue.
+ * Returns 1 if the error queue had anything on it, 0 if the error is a real
+ * socket error that read() and write() should report.
+ */
+static int uv__stream_zerocopy_reap(uv_stream_t* stream) {
+  union {
+    char data[128];
+    struct cmsghdr alias;
+  } scratch;
+  struct uv__sock_extended_err* ee;
+  struct cmsghdr* cmsg;
+  struct msghdr msg;
+  uv_tcp_t* tcp;
+  ssize_t r;
+  int reaped;
+
+  tcp = (uv_tcp_t*) stream;
+  if (tcp->zerocopy_pending == 0)
+    return 0;
+
+  reaped = 0;
+  while (tcp->zerocopy_pending != 0) {
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = scratch.data;
+    msg.msg_controllen = sizeof(scratch.data);
+
+    do
+      r = recvmsg(uv__stream_fd(stream), &msg, MSG_ERRQUEUE);
+    while (r == -1 && errno == EINTR);
+
+    if (r == -1)
+      break;
+
+    reaped = 1;
+    for (cmsg = CMSG_FIRSTHDR(&msg);
+         cmsg != NULL;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (!(cmsg->cmsg_level == IPPROTO_IP &&
+            cmsg->cmsg_type == IP_RECVERR) &&
+          !(cmsg->cmsg_level == IPPROTO_IPV6 &&
+            cmsg->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+
+      ee = (struct uv__sock_extended_err*) CMSG_DATA(cmsg);
+      if (ee->ee_errno == 0 && ee->ee_origin == UV__SO_EE_ORIGIN_ZEROCOPY)
+        uv__stream_zerocopy_release(stream, ee->ee_info, ee->ee_data);
+    }
+  }
+
+  if (!reaped)
+    return 0;
+
+  uv__io_drained(&stream->io_watcher, UV__POLLERR);
+
+  if (tcp->zerocopy_pending == 0)
+    uv__io_stop(stream->loop, &stream->io_watcher, UV__POLLERR);
+
+  return 1;
+}
+#endif /* defined(__linux__) */
+
+
+static void uv__write_req_error(uv_stream_t* stream,
+                                uv_write_t* req,
+                                int err) {
+  req->error = err;
+  uv__write_req_finish(req);
+  uv__io_stop(stream->loop, &stream->io_watcher, UV__POLLOUT);
+  if (!uv__io_active(&stream->io_watcher, UV__POLLIN))
+    uv__handle_stop(stream);
+  uv__stream_osx_interrupt_select(stream);
+}
+
+
+/* Fallback for when sendfile() can't be used: read a chunk from the file and
+ * write it out. Bytes that were read but didn't fit into the socket buffer are
+ * simply read again on the next attempt.
+ */
+static ssize_t uv__write_file_emul(int out_fd, uv_write_t* req, size_t len) {
+  char buf[16384];
+  ssize_t nread;
+  ssize_t n;
+
+  if (len > sizeof(buf))
+    len = sizeof(buf);
+
+  do
+    nread = pread(req->file, buf, len, req->file_offset);
+  while (nread == -1 && errno == EINTR);
+
+  if (nread <= 0)
+    return nread;
+
+  do
+    n = write(out_fd, buf, nread);
+  while (n == -1 && errno == EINTR);
+
+  if (n > 0)
+    req->file_offset += n;
+
+  return n;
+}
+
+
+/* Returns the number of bytes sent, 0 if the file ended before the range did
+ * or -1 with errno set.
+ */
+static ssize_t uv__write_file_send(int out_fd, uv_write_t* req) {
+  size_t len;
+
+  len = req->bufs[0].len;
+
+#if defined(__linux__) || defined(__sun)
+  {
+    off_t off;
+    ssize_t r;
+
+    off = req->file_offset;
+
+    do
+      r = sendfile(out_fd, req->file, &off, len);
+    while (r == -1 && errno == EINTR && off == req->file_offset);
+
+    /* sendfile() can return -1 after a partial write, the offset is what
+     * tells us how much went out.
+     */
+    if (off != req->file_offset) {
+      r = off - req->file_offset;
+      req->file_offset = off;
+      return r;
+    }
+
+    if (r != -1 || (errno != EINVAL && errno != EIO && errno != ENOTSOCK &&
+                    errno != EXDEV && errno != ENOSYS)) {
+      return r;
+    }
+  }
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+  {
+    off_t sbytes;
+    int r;
+
+#if defined(__FreeBSD__)
+    sbytes = 0;
+    r = sendfile(req->file, out_fd, req->file_offset, len, NULL, &sbytes, 0);
+#else
+    /* The darwin sendfile takes len as an input for the length to send,
+     * so make sure to initialize it with the caller's value.
+     */
+    sbytes = len;
+    r = sendfile(req->file, out_fd, req->file_offset, &sbytes, NULL, 0);
+#endif
+
+    /* Partial writes are reported through sbytes, even on EAGAIN. */
+    if (sbytes != 0) {
+      req->file_offset += sbytes;
+      return sbytes;
+    }
+
+    if (r == 0)
+      return 0;  /* Nothing sent and no error: end of file. */
+
+    if (errno == EAGAIN || errno == EINTR) {
+      errno = EAGAIN;
+      return -1;
+    }
+
+    if (errno != EINVAL && errno != EIO && errno != ENOTSOCK &&
+        errno != EXDEV && errno != EOPNOTSUPP && errno != ENOSYS) {
+      return -1;
+    }
+  }
+#endif
+
+  return uv__write_file_emul(out_fd, req, len);
+}
+
+
+/* File-backed write requests carry a single uv_buf_t whose len is the number
+ * of bytes left to send, that keeps the write_queue_size accounting in sync
+ * with ordinary requests. The base pointer is never touched.
+ */
+static void uv__write_file(uv_stream_t* stream, uv_write_t* req) {
+  ssize_t n;
+
+  for (;;) {
+    n = uv__write_file_send(uv__stream_fd(stream), req);
+
+    if (n == 0) {
+      uv__write_req_error(stream, req, -EIO);
+      return;
+    }
+
+    if (n == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        if (stream->flags & UV_STREAM_BLOCKING)
+          continue;
+        uv__io_drained(&stream->io_watcher, UV__POLLOUT);
+        break;
+      }
+      uv__write_req_error(stream, req, -errno);
+      return;
+    }
+
+    assert((size_t) n <= req->bufs[0].len);
+    assert(stream->write_queue_size >= (size_t) n);
+    req->bufs[0].len -= n;
+    stream->write_queue_size -= n;
+
+    if (req->bufs[0].len == 0) {
+      req->write_index = 1;
+      uv__write_req_finish(req);
+      return;
+    }
+
+    if (!(stream->flags & UV_STREAM_BLOCKING))
+      break;
+  }
+
+  uv__io_start(stream->loop, &stream->io_watcher, UV__POLLOUT);
+  uv__stream_osx_interrupt_select(stream);
+}
+
+
+/* Upper bound on the buffers that uv__write() gathers from several requests,
+ * Linux's IOV_MAX.
+ */
+#define UV__WRITE_GATHER_MAX 1024
+
+/* Requests that carry nothing but buffers can share a writev() call. */
+static int uv__write_gatherable(uv_stream_t* stream, uv_write_t* req) {
+  if (req->send_handle != NULL || req->file != -1)
+    return 0;
+
+#if defined(__linux__)
+  if (uv__write_zerocopy_ok(stream, req))
+    return 0;
+#endif
+
+  return 1;
+}
+
+
+/* Collects the unwritten buffers of the request at `q` and of the gatherable
+ * requests queued behind it into `iov`. The last request may not fit in its
+ * entirety, uv__write() picks up from there next time.
+ */
+static int uv__write_gather(uv_stream_t* stream,
+                            QUEUE* q,
+                            struct iovec* iov,
+                            int iovmax) {
+  uv_write_t* req;
+  unsigned int i;
+  int iovcnt;
+
+  iovcnt = 0;
+
+  do {
+    req = QUEUE_DATA(q, uv_write_t, queue);
+    if (iovcnt > 0 && !uv__write_gatherable(stream, req))
+      break;
+
+    for (i = req->write_index; i < req->nbufs && iovcnt < iovmax; i++) {
+      iov[iovcnt].iov_base = req->bufs[i].base;
+      iov[iovcnt].iov_len = req->bufs[i].len;
+      iovcnt++;
+    }
+
+    q = QUEUE_NEXT(q);
+  }
+  while (q != &stream->write_queue && iovcnt < iovmax);
+
+  return iovcnt;
+}
+
+
 static void uv__write(uv_stream_t* stream) {
+  struct iovec iovs[UV__WRITE_GATHER_MAX];
   struct iovec* iov;
   QUEUE* q;
   uv_write_t* req;
@@ -709,6 +1192,11 @@ start:
   req = QUEUE_DATA(q, uv_write_t, queue);
   assert(req->handle == stream);
 
+  if (req->file != -1) {
+    uv__write_file(stream, req);
+    return;
+  }
+
   /*
    * Cast to iovec. We had to have our own uv_buf_t instead of iovec
    * because Windows's WSABUF is not an iovec.
@@ -723,6 +1211,18 @@ start:
   if (iovcnt > iovmax)
     iovcnt = iovmax;
 
+  /* A run of small requests, e.g. a framing header and its payload written
+   * separately, goes out with a single writev() instead of one per request.
+   */
+  if (iovcnt < iovmax &&
+      QUEUE_NEXT(q) != &stream->write_queue &&
+      uv__write_gatherable(stream, req)) {
+    if (iovmax > (int) ARRAY_SIZE(iovs))
+      iovmax = ARRAY_SIZE(iovs);
+    iov = iovs;
+    iovcnt = uv__write_gather(stream, q, iov, iovmax);
+  }
+
   /*
    * Now do the actual writev. Note that we've been updating the pointers
    * inside the iov each time we write. So there is no need to offset it.
@@ -761,13 +1261,29 @@ start:
       n = sendmsg(uv__stream_fd(stream), &msg, 0);
     }
     while (n == -1 && errno == EINTR);
+#if defined(__linux__)
+  } else if (uv__write_zerocopy_ok(stream, req)) {
+    n = uv__write_zerocopy(stream, req, iov, iovcnt);
+#endif
   } else {
     do {
+#if defined(__linux__)
+      /* Blocking writes are retried right here, uv_try_write() takes back
+       * what doesn't fit; neither can leave the rest to the ring.
+       */
+      n = uv__iou_write(stream->loop,
+                        &stream->io_watcher,
+                        iov,
+                        iovcnt,
+                        !(stream->flags & UV_STREAM_BLOCKING) &&
+                            req->cb != uv_try_write_cb);
+#else
       if (iovcnt == 1) {
         n = write(uv__stream_fd(stream), iov[0].iov_base, iov[0].iov_len);
       } else {
         n = writev(uv__stream_fd(stream), iov, iovcnt);
       }
+#endif
     }
     while (n == -1 && errno == EINTR);
   }
@@ -775,16 +1291,13 @@ start:
   if (n < 0) {
     if (errno != EAGAIN && errno != EWOULDBLOCK) {
       /* Error */
-      req->error = -errno;
-      uv__write_req_finish(req);
-      uv__io_stop(stream->loop, &stream->io_watcher, UV__POLLOUT);
-      if (!uv__io_active(&stream->io_watcher, UV__POLLIN))
-        uv__handle_stop(stream);
-      uv__stream_osx_interrupt_select(stream);
+      uv__write_req_error(stream, req, -errno);
       return;
     } else if (stream->flags & UV_STREAM_BLOCKING) {
       /* If this is a blocking stream, try again. */
       goto start;
+    } else {
+      uv__io_drained(&stream->io_watcher, UV__POLLOUT);
     }
   } else {
     /* Successful write */
@@ -825,10 +1338,17 @@ start:
 
         if (req->write_index == req->nbufs) {
           /* Then we're done! */
-          assert(n == 0);
           uv__write_req_finish(req);
-          /* TODO: start trying to write the next request. */
-          return;
+          if (n == 0) {
+            /* TODO: start trying to write the next request. */
+            return;
+          }
+
+          /* The write spilled over into the next gathered request. */
+          assert(!QUEUE_EMPTY(&stream->write_queue));
+          q = QUEUE_HEAD(&stream->write_queue);
+          req = QUEUE_DATA(q, uv_write_t, queue);
+          assert(req->handle == stream);
         }
       }
     }
@@ -848,6 +1368,24 @@ start:
 }
 
 
+static void uv__stream_watermark(uv_stream_t* stream) {
+  if (stream->watermark_cb == NULL || uv__is_closing(stream))
+    return;
+
+  if (stream->flags & UV_STREAM_WRITE_HIGH) {
+    if (stream->write_queue_size > stream->write_low)
+      return;
+    stream->flags &= ~UV_STREAM_WRITE_HIGH;
+    stream->watermark_cb(stream, 0);
+  } else {
+    if (stream->write_queue_size < stream->write_high)
+      return;
+    stream->flags |= UV_STREAM_WRITE_HIGH;
+    stream->watermark_cb(stream, 1);
+  }
+}
+
+
 static void uv__write_callbacks(uv_stream_t* stream) {
   uv_write_t* req;
   QUEUE* q;
@@ -872,6 +1410,9 @@ static void uv__write_callbacks(uv_stream_t* stream) {
   }
 
   assert(QUEUE_EMPTY(&stream->write_completed_queue));
+
+  /* Covers partial writes too, uv__stream_io() calls us after uv__write(). */
+  uv__stream_watermark(stream);
 }
 
 
@@ -1013,10 +1554,14 @@ static int uv__stream_recv_cmsg(uv_stream_t* stream, struct msghdr* msg) {
 
 
 static void uv__read(uv_stream_t* stream) {
+  uv_loop_t* loop;
   uv_buf_t buf;
   ssize_t nread;
   struct msghdr msg;
   char cmsg_space[CMSG_SPACE(UV__CMSG_FD_SIZE)];
+  unsigned int size_class;
+  int framed;
+  int pooled;
   int count;
   int err;
   int is_ipc;
@@ -1024,33 +1569,68 @@ static void uv__read(uv_stream_t* stream) {
   stream->flags &= ~UV_STREAM_READ_PARTIAL;
 
   /* Prevent loop starvation when the data comes in as fast as (or faster than)
-   * we can read it. XXX Need to rearm fd if we switch to edge-triggered I/O.
+   * we can read it. Edge-triggered watchers that stop short of EAGAIN are
+   * rearmed by uv__io_poll().
    */
   count = 32;
 
   is_ipc = stream->type == UV_NAMED_PIPE && ((uv_pipe_t*) stream)->ipc;
 
+  /* Pooled buffers go back after the read callback, which may close and free
+   * the stream, hence the copy of the loop pointer.
+   */
+  loop = stream->loop;
+  size_class = 0;
+
+  /* Hand out what a previous read left in the frame buffer first. */
+  if (uv__frame_pending(stream)) {
+    uv__frame_read(stream, 0);
+    if (uv__frame_pending(stream))
+      return;
+  }
+
   /* XXX: Maybe instead of having UV_STREAM_READING we just test if
    * tcp->read_cb is NULL or not?
    */
   while (stream->read_cb
       && (stream->flags & UV_STREAM_READING)
       && (count-- > 0)) {
-    assert(stream->alloc_cb != NULL);
+    /* Only handles started without an alloc_cb read into pooled buffers,
+     * their read callbacks know not to free them. The callback may restart
+     * reading with a different alloc_cb, look again every time.
+     */
+    pooled = (stream->alloc_cb == NULL && stream->frame == NULL);
+
+    if (stream->frame != NULL) {
+      if (uv__frame_alloc(stream, &buf))
+        buf = uv_buf_init(NULL, 0);
+    } else if (pooled) {
+      if (uv__read_pool_get(loop, size_class, &buf))
+        buf = uv_buf_init(NULL, 0);
+    } else {
+      assert(stream->alloc_cb != NULL);
+      stream->alloc_cb((uv_handle_t*)stream, 64 * 1024, &buf);
+    }
 
-    stream->alloc_cb((uv_handle_t*)stream, 64 * 1024, &buf);
     if (buf.len == 0) {
       /* User indicates it can't or won't handle the read. */
       stream->read_cb(stream, UV_ENOBUFS, &buf);
       return;
     }
 
+    /* The frame buffer is never handed to the callback as is. */
+    framed = (stream->frame != NULL);
+
     assert(buf.base != NULL);
     assert(uv__stream_fd(stream) >= 0);
 
     if (!is_ipc) {
       do {
+#if defined(__linux__)
+        nread = uv__iou_read(loop, &stream->io_watcher, buf.base, buf.len);
+#else
         nread = read(uv__stream_fd(stream), buf.base, buf.len);
+#endif
       }
       while (nread < 0 && errno == EINTR);
     } else {
@@ -1074,20 +1654,30 @@ static void uv__read(uv_stream_t* stream) {
       /* Error */
       if (errno == EAGAIN || errno == EWOULDBLOCK) {
         /* Wait for the next one. */
+        uv__io_drained(&stream->io_watcher, UV__POLLIN);
         if (stream->flags & UV_STREAM_READING) {
           uv__io_start(stream->loop, &stream->io_watcher, UV__POLLIN);
           uv__stream_osx_interrupt_select(stream);
         }
-        stream->read_cb(stream, 0, &buf);
+        if (!framed)
+          stream->read_cb(stream, 0, &buf);
       } else {
         /* Error. User should call uv_close(). */
+        if (framed)
+          buf = uv_buf_init(NULL, 0);
         stream->read_cb(stream, -errno, &buf);
         assert(!uv__io_active(&stream->io_watcher, UV__POLLIN) &&
                "stream->read_cb(status=-1) did not call uv_close()");
       }
+      if (pooled)
+        uv__read_pool_put(loop, &buf);
       return;
     } else if (nread == 0) {
+      if (framed)
+        buf = uv_buf_init(NULL, 0);
       uv__stream_eof(stream, &buf);
+      if (pooled)
+        uv__read_pool_put(loop, &buf);
       return;
     } else {
       /* Successful read */
@@ -1096,15 +1686,36 @@ static void uv__read(uv_stream_t* stream) {
       if (is_ipc) {
         err = uv__stream_recv_cmsg(stream, &msg);
         if (err != 0) {
+          if (framed)
+            buf = uv_buf_init(NULL, 0);
           stream->read_cb(stream, err, &buf);
+          if (pooled)
+            uv__read_pool_put(loop, &buf);
           return;
         }
       }
-      stream->read_cb(stream, nread, &buf);
+      if (framed)
+        uv__frame_read(stream, nread);
+      else
+        stream->read_cb(stream, nread, &buf);
+
+      if (pooled) {
+        uv__read_pool_put(loop, &buf);
+        /* A full buffer means there's likely more, read it in larger bites. */
+        if (nread == buflen && size_class + 1 < UV__READ_POOL_CLASSES)
+          size_class++;
+      }
 
       /* Return if we didn't fill the buffer, there is no more data to read. */
       if (nread < buflen) {
         stream->flags |= UV_STREAM_READ_PARTIAL;
+        /* Only a TCP socket is known to be drained by a short read; pipes
+         * stop at message boundaries when passing file descriptors. Not so
+         * once the peer has hung up, the EOF that's still to be read won't
+         * raise another edge.
+         */
+        if (stream->type == UV_TCP && !uv__io_peer_closed(&stream->io_watcher))
+          uv__io_drained(&stream->io_watcher, UV__POLLIN);
         return;
       }
     }
@@ -1130,6 +1741,9 @@ int uv_shutdown(uv_shutdown_t* req, uv_stream_t* stream, uv_shutdown_cb cb) {
 
   assert(uv__stream_fd(stream) >= 0);
 
+  if (stream->splice[0] != NULL || stream->splice[1] != NULL)
+    return -EBUSY;
+
   /* Initialize request */
   uv__req_init(stream->loop, req, UV_SHUTDOWN);
   req->handle = stream;
@@ -1161,9 +1775,37 @@ static void uv__stream_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
 
   assert(uv__stream_fd(stream) >= 0);
 
+#if defined(__linux__)
+  /* Zero-copy notifications don't make the socket readable or writable. */
+  if ((events & UV__POLLERR) &&
+      stream->type == UV_TCP &&
+      uv__stream_zerocopy_reap(stream)) {
+    events &= ~UV__POLLERR;
+    uv__write_callbacks(stream);
+
+    if (uv__stream_fd(stream) == -1)
+      return;  /* write_cb closed stream. */
+
+    /* A shutdown may have waited for the last of them. */
+    if (QUEUE_EMPTY(&stream->write_queue)) {
+      uv__drain(stream);
+      if (uv__stream_fd(stream) == -1)
+        return;  /* shutdown_cb closed stream. */
+    }
+  }
+#endif
+
+  if (stream->splice[0] != NULL || stream->splice[1] != NULL) {
+    uv__write_callbacks(stream);
+    uv__splice_io(stream, events);
+    return;
+  }
+
   /* Ignore POLLHUP here. Even it it's set, there may still be data to read. */
-  if (events & (UV__POLLIN | UV__POLLERR | UV__POLLHUP))
+  if ((events & (UV__POLLIN | UV__POLLERR | UV__POLLHUP)) ||
+      uv__frame_pending(stream)) {
     uv__read(stream);
+  }
 
   if (uv__stream_fd(stream) == -1)
     return;  /* read_cb closed stream. */
@@ -1256,6 +1898,9 @@ int uv_write2(uv_write_t* req,
   if (uv__stream_fd(stream) < 0)
     return -EBADF;
 
+  if (stream->splice[0] != NULL || stream->splice[1] != NULL)
+    return -EBUSY;
+
   if (send_handle) {
     if (stream->type != UV_NAMED_PIPE || !((uv_pipe_t*)stream)->ipc)
       return -EINVAL;
@@ -1284,6 +1929,9 @@ int uv_write2(uv_write_t* req,
   req->handle = stream;
   req->error = 0;
   req->send_handle = send_handle;
+  req->zerocopy_sent = 0;
+  req->zerocopy_done = 0;
+  req->file = -1;
   QUEUE_INIT(&req->queue);
 
   req->bufs = req->bufsml;
@@ -1298,16 +1946,83 @@ int uv_write2(uv_write_t* req,
   req->write_index = 0;
   stream->write_queue_size += uv__count_bufs(bufs, nbufs);
 
+  uv__write_queue(stream, req, empty_queue);
+
+  /* uv_try_write() takes its unwritten bytes back out of the queue. */
+  if (cb != uv_try_write_cb)
+    uv__stream_watermark(stream);
+
+  return 0;
+}
+
+
+int uv_write_file(uv_write_t* req,
+                  uv_stream_t* stream,
+                  uv_file file,
+                  int64_t offset,
+                  size_t length,
+                  uv_write_cb cb) {
+  int empty_queue;
+
+  assert((stream->type == UV_TCP ||
+          stream->type == UV_NAMED_PIPE ||
+          stream->type == UV_TTY) &&
+         "uv_write_file (unix) does not yet support other types of streams");
+
+  if (file < 0 || offset < 0 || length == 0)
+    return -EINVAL;
+
+  if (uv__stream_fd(stream) < 0)
+    return -EBADF;
+
+  if (stream->splice[0] != NULL || stream->splice[1] != NULL)
+    return -EBUSY;
+
+  /* See uv_write2(). */
+  empty_queue = (stream->write_queue_size == 0);
+
+  uv__req_init(stream->loop, req, UV_WRITE);
+  req->cb = cb;
+  req->handle = stream;
+  req->error = 0;
+  req->send_handle = NULL;
+  req->zerocopy_sent = 0;
+  req->zerocopy_done = 0;
+  req->file = file;
+  req->file_offset = offset;
+  QUEUE_INIT(&req->queue);
+
+  req->bufs = req->bufsml;
+  req->bufs[0].base = NULL;
+  req->bufs[0].len = length;
+  req->nbufs = 1;
+  req->write_index = 0;
+  stream->write_queue_size += length;
+
+  uv__write_queue(stream, req, empty_queue);
+  uv__stream_watermark(stream);
+  return 0;
+}
+
+
+static void uv__write_queue(uv_stream_t* stream,
+                            uv_write_t* req,
+                            int empty_queue) {
   /* Append the request to write_queue. */
   QUEUE_INSERT_TAIL(&stream->write_queue, &req->queue);
 
-  /* If the queue was empty when this function began, we should attempt to
-   * do the write immediately. Otherwise start the write_watcher and wait
+  /* If the queue was empty when the request was submitted, we should attempt
+   * to do the write immediately. Otherwise start the write_watcher and wait
    * for the fd to become writable.
    */
   if (stream->connect_req) {
     /* Still connecting, do nothing. */
   }
+  else if ((stream->flags & UV_STREAM_CORKED) && req->cb != uv_try_write_cb) {
+    /* Batched, uv__stream_flush_all() writes it before the loop polls. */
+    if (QUEUE_EMPTY(&stream->flush_queue))
+      QUEUE_INSERT_TAIL(&stream->loop->flush_queue, &stream->flush_queue);
+  }
   else if (empty_queue) {
     uv__write(stream);
   }
@@ -1321,8 +2036,6 @@ int uv_write2(uv_write_t* req,
     uv__io_start(stream->loop, &stream->io_watcher, UV__POLLOUT);
     uv__stream_osx_interrupt_select(stream);
   }
-
-  return 0;
 }
 
 
@@ -1392,15 +2105,9 @@ int uv_try_write(uv_stream_t* stream,
 }
 
 
-int uv_read_start(uv_stream_t* stream,
-                  uv_alloc_cb alloc_cb,
-                  uv_read_cb read_cb) {
-  assert(stream->type == UV_TCP || stream->type == UV_NAMED_PIPE ||
-      stream->type == UV_TTY);
-
-  if (stream->flags & UV_CLOSING)
-    return -EINVAL;
-
+static void uv__read_start(uv_stream_t* stream,
+                           uv_alloc_cb alloc_cb,
+                           uv_read_cb read_cb) {
   /* The UV_STREAM_READING flag is irrelevant of the state of the tcp - it just
    * expresses the desired state of the user.
    */
@@ -1411,14 +2118,74 @@ int uv_read_start(uv_stream_t* stream,
    * not start the IO watcher.
    */
   assert(uv__stream_fd(stream) >= 0);
-  assert(alloc_cb);
 
   stream->read_cb = read_cb;
   stream->alloc_cb = alloc_cb;
 
+  /* Byte streams can read ahead on the io_uring, see uv__iou_read(). */
+  if ((stream->type == UV_TCP ||
+       (stream->type == UV_NAMED_PIPE && !((uv_pipe_t*) stream)->ipc)) &&
+      !(stream->flags & UV_STREAM_BLOCKING)) {
+    uv__io_set_ring(&stream->io_watcher, UV__IO_RING_READ);
+  }
+
   uv__io_start(stream->loop, &stream->io_watcher, UV__POLLIN);
   uv__handle_start(stream);
   uv__stream_osx_interrupt_select(stream);
+}
+
+
+int uv_read_start(uv_stream_t* stream,
+                  uv_alloc_cb alloc_cb,
+                  uv_read_cb read_cb) {
+  assert(stream->type == UV_TCP || stream->type == UV_NAMED_PIPE ||
+      stream->type == UV_TTY);
+
+  if (stream->flags & UV_CLOSING)
+    return -EINVAL;
+
+  if (stream->splice[0] != NULL || stream->splice[1] != NULL)
+    return -EBUSY;
+
+  /* The alloc_cb is optional when the loop lends the buffers. */
+  if (alloc_cb == NULL && !uv__read_pool_enabled(stream->loop))
+    return -EINVAL;
+
+  /* Leaving framed mode, a partial frame is meaningless without it. */
+  uv__frame_free(stream);
+  uv__read_start(stream, alloc_cb, read_cb);
+
+  return 0;
+}
+
+
+int uv_read_start_framed(uv_stream_t* stream,
+                         unsigned int flags,
+                         int delimiter,
+                         size_t max_frame,
+                         uv_read_cb read_cb) {
+  int err;
+
+  assert(stream->type == UV_TCP || stream->type == UV_NAMED_PIPE ||
+      stream->type == UV_TTY);
+
+  if (stream->flags & UV_CLOSING)
+    return -EINVAL;
+
+  if (stream->splice[0] != NULL || stream->splice[1] != NULL)
+    return -EBUSY;
+
+  err = uv__frame_init(stream, flags, delimiter, max_frame);
+  if (err)
+    return err;
+
+  uv__read_start(stream, NULL, read_cb);
+
+  /* Frames that were left over when reading stopped don't make the fd
+   * readable, uv__stream_io() hands them out on the next tick.
+   */
+  if (uv__frame_pending(stream))
+    uv__io_feed(stream->loop, &stream->io_watcher);
 
   return 0;
 }
@@ -1499,6 +2266,9 @@ void uv__stream_close(uv_stream_t* handle) {
   }
 #endif /* defined(__APPLE__) */
 
+  QUEUE_REMOVE(&handle->flush_queue);
+  QUEUE_INIT(&handle->flush_queue);
+  uv__splice_close(handle);
   uv__io_close(handle->loop, &handle->io_watcher);
   uv_read_stop(handle);
   uv__handle_stop(handle);
@@ -1528,6 +2298,71 @@ void uv__stream_close(uv_stream_t* handle) {
 }
 
 
+static void uv__stream_flush(uv_stream_t* stream) {
+  QUEUE_REMOVE(&stream->flush_queue);
+  QUEUE_INIT(&stream->flush_queue);
+
+  if (stream->connect_req != NULL || QUEUE_EMPTY(&stream->write_queue))
+    return;
+
+  /* Already waiting for the fd to become writable, uv__stream_io() writes
+   * everything that's queued when it is.
+   */
+  if (uv__io_active(&stream->io_watcher, UV__POLLOUT))
+    return;
+
+  uv__write(stream);
+}
+
+
+void uv__stream_flush_all(uv_loop_t* loop) {
+  uv_stream_t* stream;
+  QUEUE* q;
+
+  while (!QUEUE_EMPTY(&loop->flush_queue)) {
+    q = QUEUE_HEAD(&loop->flush_queue);
+    stream = QUEUE_DATA(q, uv_stream_t, flush_queue);
+    uv__stream_flush(stream);
+  }
+}
+
+
+int uv_stream_set_cork(uv_stream_t* handle, int enable) {
+  if (enable) {
+    handle->flags |= UV_STREAM_CORKED;
+    return 0;
+  }
+
+  handle->flags &= ~UV_STREAM_CORKED;
+  return uv_stream_flush(handle);
+}
+
+
+int uv_stream_flush(uv_stream_t* handle) {
+  if (!QUEUE_EMPTY(&handle->flush_queue))
+    uv__stream_flush(handle);
+
+  return 0;
+}
+
+
+int uv_stream_set_watermarks(uv_stream_t* handle,
+                             size_t high,
+                             size_t low,
+                             uv_watermark_cb cb) {
+  if (cb != NULL && low > high)
+    return -EINVAL;
+
+  handle->flags &= ~UV_STREAM_WRITE_HIGH;
+  handle->watermark_cb = cb;
+  handle->write_high = high;
+  handle->write_low = low;
+  uv__stream_watermark(handle);
+
+  return 0;
+}
+
+
 int uv_stream_set_blocking(uv_stream_t* handle, int blocking) {
   return UV_ENOSYS;
 }
@@ -30,6 +30,12 @@
 
 int uv_tcp_init(uv_loop_t* loop, uv_tcp_t* tcp) {
   uv__stream_init(loop, (uv_stream_t*)tcp, UV_TCP);
+  QUEUE_INIT(&tcp->zerocopy_queue);
+  tcp->zerocopy_threshold = 0;
+  tcp->zerocopy_next = 0;
+  tcp->zerocopy_pending = 0;
+  tcp->notsent_lowat = 0;
+  tcp->connect_host_req = NULL;
   return 0;
 }
 
@@ -77,6 +83,15 @@ int uv__tcp_bind(uv_tcp_t* tcp,
   if (setsockopt(tcp->io_watcher.fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)))
     return -errno;
 
+  if (flags & (UV_TCP_REUSEPORT | UV_TCP_REUSEPORT_CPU)) {
+    err = uv__set_reuseport(tcp->io_watcher.fd);
+    if (err)
+      return err;
+  }
+
+  if (flags & UV_TCP_REUSEPORT_CPU)
+    tcp->flags |= UV_TCP_REUSEPORT_STEER;
+
 #ifdef IPV6_V6ONLY
   if (addr->sa_family == AF_INET6) {
     on = (flags & UV_TCP_IPV6ONLY) != 0;
@@ -112,7 +127,7 @@ int uv__tcp_connect(uv_connect_t* req,
 
   assert(handle->type == UV_TCP);
 
-  if (handle->connect_req != NULL)
+  if (handle->connect_req != NULL || handle->connect_host_req != NULL)
     return -EALREADY;  /* FIXME(bnoordhuis) -EINVAL or maybe -EBUSY. */
 
   err = maybe_new_socket(handle,
@@ -228,10 +243,20 @@ int uv_tcp_listen(uv_tcp_t* tcp, int backlog, uv_connection_cb cb) {
   if (listen(tcp->io_watcher.fd, backlog))
     return -errno;
 
+  if (tcp->flags & UV_TCP_REUSEPORT_STEER) {
+    err = uv__reuseport_steer_cpu(tcp->io_watcher.fd);
+    if (err)
+      return err;
+  }
+
   tcp->connection_cb = cb;
 
+  if (tcp->flags & UV_TCP_EXCLUSIVE_ACCEPT)
+    uv__io_set_exclusive(&tcp->io_watcher);
+
   /* Start listening for connections. */
   tcp->io_watcher.cb = uv__server_io;
+  uv__io_set_ring(&tcp->io_watcher, UV__IO_RING_ACCEPT);
   uv__io_start(tcp->loop, &tcp->io_watcher, UV__POLLIN);
 
   return 0;
@@ -267,6 +292,17 @@ int uv__tcp_keepalive(int fd, int on, unsigned int delay) {
 }
 
 
+int uv__tcp_zerocopy(int fd, int on) {
+#if defined(__linux__)
+  if (setsockopt(fd, SOL_SOCKET, UV__SO_ZEROCOPY, &on, sizeof(on)))
+    return -errno;
+  return 0;
+#else
+  return -ENOTSUP;
+#endif
+}
+
+
 int uv_tcp_nodelay(uv_tcp_t* handle, int on) {
   int err;
 
@@ -285,6 +321,17 @@ int uv_tcp_nodelay(uv_tcp_t* handle, int on) {
 }
 
 
+int uv__tcp_notsent_lowat(int fd, unsigned int bytes) {
+#if defined(TCP_NOTSENT_LOWAT)
+  if (setsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &bytes, sizeof(bytes)))
+    return -errno;
+  return 0;
+#else
+  return -ENOTSUP;
+#endif
+}
+
+
 int uv_tcp_keepalive(uv_tcp_t* handle, int on, unsigned int delay) {
   int err;
 
@@ -316,6 +363,69 @@ int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable) {
 }
 
 
+int uv_tcp_exclusive_accept(uv_tcp_t* handle, int enable) {
+#if defined(__linux__)
+  if (handle->loop->flags & UV_LOOP_IOURING_POLL)
+    return -ENOTSUP;
+
+  if (enable)
+    handle->flags |= UV_TCP_EXCLUSIVE_ACCEPT;
+  else
+    handle->flags &= ~UV_TCP_EXCLUSIVE_ACCEPT;
+
+  return 0;
+#else
+  return -ENOTSUP;
+#endif
+}
+
+
+int uv_tcp_notsent_lowat(uv_tcp_t* handle, unsigned int bytes) {
+#if defined(TCP_NOTSENT_LOWAT)
+  int err;
+
+  if (uv__stream_fd(handle) != -1) {
+    err = uv__tcp_notsent_lowat(uv__stream_fd(handle), bytes);
+    if (err)
+      return err;
+  }
+
+  handle->notsent_lowat = bytes;
+  return 0;
+#else
+  return -ENOTSUP;
+#endif
+}
+
+
+int uv_tcp_zerocopy(uv_tcp_t* handle, int enable, size_t threshold) {
+#if defined(__linux__)
+  int err;
+
+  /* Leave SO_ZEROCOPY on when disabling, sends that are still in flight
+   * report their completion all the same.
+   */
+  if (enable && uv__stream_fd(handle) != -1) {
+    err = uv__tcp_zerocopy(uv__stream_fd(handle), 1);
+    if (err)
+      return err;
+  }
+
+  if (enable) {
+    handle->flags |= UV_TCP_ZEROCOPY;
+    handle->zerocopy_threshold = threshold;
+  } else {
+    handle->flags &= ~UV_TCP_ZEROCOPY;
+  }
+
+  return 0;
+#else
+  return -ENOTSUP;
+#endif
+}
+
+
 void uv__tcp_close(uv_tcp_t* handle) {
+  uv__connect_host_close(handle);
   uv__stream_close((uv_stream_t*)handle);
 }
@@ -20,110 +20,654 @@
  */
 
 #include "internal.h"
+#include "atomic-ops.h"
+#include <sched.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define MAX_THREADPOOL_SIZE 128
+#define NCLASSES (UV_WORK_USER + 1)
+
+/* Threads above the minimum exit after being idle for this long. */
+#define IDLE_TIMEOUT_NS ((uint64_t) 10 * 1000 * 1000 * 1000)
+
+/* Shard of a request that sits in the loop's batch, not yet posted. */
+#define BATCHED_SHARD ((unsigned int) -1)
+
+/* Every worker owns a queue of pending work per work class. Loop threads don't
+ * take a lock to submit work, they push it onto the inbox of an idle worker
+ * (or, when all workers are busy, of the next worker in round-robin order).
+ * The inbox is a lock-free LIFO that is only ever emptied in one go, under
+ * the queue mutex. Workers that run out of work steal from the queues of
+ * other workers before they go to sleep.
+ *
+ * Classes are scanned in order and a class that has reached its cap on
+ * running work is skipped, so it can't hold up the classes after it.
+ *
+ * Threads are started on demand, between min_threads and max_threads. Work
+ * that finds no idle worker starts a new thread right away, so a request
+ * never waits behind a blocked one while the pool has room to grow, and idle
+ * threads exit after IDLE_TIMEOUT_NS. A worker
+ * slot outlives its thread: the queues of a retired worker stay reachable to
+ * thieves and uv_cancel() and the slot is reused by the next thread.
+ */
+struct uv__worker {
+  uv_thread_t thread;
+  uv_mutex_t mutex;  /* Protects |queue|, |wakeup| and |live|. */
+  uv_cond_t cond;
+  QUEUE queue[NCLASSES];
+  void* inbox;       /* Linked through QUEUE_NEXT. */
+  uv_loop_t* completing;  /* Loop we're handing a finished request to. */
+  int sleeping;
+  int wakeup;
+  int live;
+};
 
 static uv_once_t once = UV_ONCE_INIT;
-static uv_cond_t cond;
-static uv_mutex_t mutex;
-static unsigned int nthreads;
-static uv_thread_t* threads;
-static uv_thread_t default_threads[4];
-static QUEUE exit_message;
-static QUEUE wq;
+static uv_mutex_t spawn_mutex;  /* Serializes starting threads. */
+static struct uv__worker* workers[MAX_THREADPOOL_SIZE];
+static unsigned int nslots;
+static int min_threads;
+static int max_threads;
+static int nlive;
+static int queued[NCLASSES];  /* Submitted but not yet picked up. */
+static int running[NCLASSES];
+static int nidle;
+static int next_worker;
+static volatile int stopping;
 static volatile int initialized;
 
+/* Totals of the loops that collect statistics. Only ever touched when one
+ * does. Updated with atomic operations.
+ */
+static uv_threadpool_stats_t global_stats;
+
+typedef void (*uv__work_cb)(struct uv__work* w);
+
+static void worker(void* arg);
+
 
 static void uv__cancelled(struct uv__work* w) {
   abort();
 }
 
 
-/* To avoid deadlock with uv_cancel() it's crucial that the worker
- * never holds the global mutex and the loop-local mutex at the same time.
+static unsigned int uv__work_now(void) {
+  return uv__hrtime(UV_CLOCK_PRECISE) / 1000;
+}
+
+
+static unsigned int uv__work_stats_bucket(unsigned int usec) {
+  unsigned int n;
+
+  for (n = 0; usec != 0 && n < UV_THREADPOOL_STATS_BUCKETS - 1; n++)
+    usec >>= 1;
+
+  return n;
+}
+
+
+/* Runs on the loop thread, before the done callback. */
+static void uv__work_stats_done(uv_loop_t* loop, struct uv__work* w, int err) {
+  uv_threadpool_type_stats_t* ls;
+  uv_threadpool_type_stats_t* gs;
+  unsigned int wait_bucket;
+  unsigned int run_bucket;
+
+  ls = &((uv_threadpool_stats_t*) loop->wq_stats)->types[w->type];
+  gs = &global_stats.types[w->type];
+
+  if (err == -ECANCELED) {
+    ls->cancelled++;
+    xaddi((int*) &gs->cancelled, 1);
+    return;
+  }
+
+  wait_bucket = uv__work_stats_bucket(w->wait_time);
+  run_bucket = uv__work_stats_bucket(w->run_time);
+  ls->completed++;
+  ls->wait_time[wait_bucket]++;
+  ls->run_time[run_bucket]++;
+  xaddi((int*) &gs->completed, 1);
+  xaddi((int*) &gs->wait_time[wait_bucket], 1);
+  xaddi((int*) &gs->run_time[run_bucket], 1);
+}
+
+
+static void uv__work_stats_queued(struct uv__work* w, int n) {
+  uv_threadpool_stats_t* ls;
+
+  ls = w->loop->wq_stats;
+  xaddi((int*) &ls->types[w->type].queued, n);
+  xaddi((int*) &global_stats.types[w->type].queued, n);
+}
+
+
+static int uv__class_cap(unsigned int cls) {
+  int n;
+
+  n = *(volatile int*) &max_threads;
+
+  switch (cls) {
+  case UV_WORK_SLOW_IO:
+    return (n + 1) / 2;
+  case UV_WORK_CPU:
+    return n > 1 ? n - 1 : 1;
+  default:
+    return n;
+  }
+}
+
+
+/* Returns non-zero if there is queued work that a worker may start now. */
+static int uv__work_runnable(void) {
+  unsigned int cls;
+
+  for (cls = 0; cls < NCLASSES; cls++)
+    if (*(volatile int*) &queued[cls] > 0 &&
+        *(volatile int*) &running[cls] < uv__class_cap(cls))
+      return 1;
+
+  return 0;
+}
+
+
+/* Starts a worker thread unless there are max_threads already. Threads are
+ * started from the loop thread and from workers, never with a queue mutex
+ * held.
  */
-static void worker(void* arg) {
+static void uv__worker_spawn(void) {
+  struct uv__worker* wk;
+  unsigned int i;
+  unsigned int j;
+
+  uv_mutex_lock(&spawn_mutex);
+
+  if (stopping || nlive >= max_threads)
+    goto out;
+
+  for (i = 0; i < nslots; i++) {
+    uv_mutex_lock(&workers[i]->mutex);
+    j = workers[i]->live;
+    uv_mutex_unlock(&workers[i]->mutex);
+    if (j == 0)
+      break;
+  }
+
+  if (i == nslots) {
+    if (nslots == ARRAY_SIZE(workers))
+      goto out;
+
+    wk = malloc(sizeof(*wk));
+    if (wk == NULL)
+      goto out;
+
+    if (uv_mutex_init(&wk->mutex))
+      abort();
+    if (uv_cond_init(&wk->cond))
+      abort();
+    for (j = 0; j < NCLASSES; j++)
+      QUEUE_INIT(&wk->queue[j]);
+    wk->inbox = NULL;
+    wk->completing = NULL;
+    wk->sleeping = 0;
+    wk->wakeup = 0;
+    wk->live = 0;
+
+    workers[i] = wk;
+    cmpxchgi((int*) &nslots, i, i + 1);  /* Publish. */
+  }
+
+  wk = workers[i];
+  uv_mutex_lock(&wk->mutex);
+  wk->live = 1;
+  uv_mutex_unlock(&wk->mutex);
+  xaddi(&nlive, 1);
+
+  if (uv_thread_create(&wk->thread, worker, wk)) {
+    uv_mutex_lock(&wk->mutex);
+    wk->live = 0;
+    uv_mutex_unlock(&wk->mutex);
+    xaddi(&nlive, -1);
+  }
+
+out:
+  /* Queued work would never run. */
+  if (nlive == 0 && !stopping)
+    abort();
+
+  uv_mutex_unlock(&spawn_mutex);
+}
+
+
+/* Moves the inbox to the tails of the queues, oldest first. Must be called
+ * with the worker's mutex held.
+ */
+static void uv__worker_drain(struct uv__worker* wk) {
   struct uv__work* w;
+  QUEUE* head;
+  QUEUE* seen;
   QUEUE* q;
+  QUEUE tmp;
 
-  (void) arg;
+  head = NULL;
+  while ((seen = cmpxchgp(&wk->inbox, head, NULL)) != head)
+    head = seen;
 
-  for (;;) {
-    uv_mutex_lock(&mutex);
+  if (head == NULL)
+    return;
 
-    while (QUEUE_EMPTY(&wq))
-      uv_cond_wait(&cond, &mutex);
+  QUEUE_INIT(&tmp);
+  while (head != NULL) {
+    q = head;
+    head = QUEUE_NEXT(q);
+    QUEUE_INSERT_HEAD(&tmp, q);
+  }
 
-    q = QUEUE_HEAD(&wq);
+  while (!QUEUE_EMPTY(&tmp)) {
+    q = QUEUE_HEAD(&tmp);
+    QUEUE_REMOVE(q);
+    w = QUEUE_DATA(q, struct uv__work, wq);
+    QUEUE_INSERT_TAIL(&wk->queue[w->cls], q);
+  }
+}
+
+
+static QUEUE* uv__worker_pop(struct uv__worker* wk) {
+  unsigned int cls;
+  QUEUE* q;
+
+  q = NULL;
+  uv_mutex_lock(&wk->mutex);
+  uv__worker_drain(wk);
+
+  for (cls = 0; cls < NCLASSES; cls++) {
+    if (QUEUE_EMPTY(&wk->queue[cls]))
+      continue;
 
-    if (q == &exit_message)
-      uv_cond_signal(&cond);
-    else {
-      QUEUE_REMOVE(q);
-      QUEUE_INIT(q);  /* Signal uv_cancel() that the work req is
-                             executing. */
+    if (xaddi(&running[cls], 1) >= uv__class_cap(cls)) {
+      xaddi(&running[cls], -1);
+      continue;
     }
 
-    uv_mutex_unlock(&mutex);
+    q = QUEUE_HEAD(&wk->queue[cls]);
+    QUEUE_REMOVE(q);
+    QUEUE_INIT(q);  /* Signal uv_cancel() that the work req is executing. */
+    xaddi(&queued[cls], -1);
+    break;
+  }
+
+  uv_mutex_unlock(&wk->mutex);
+  return q;
+}
+
+
+/* Takes work from our own queue first, then from the other workers. */
+static QUEUE* uv__worker_take(struct uv__worker* self) {
+  unsigned int base;
+  unsigned int n;
+  unsigned int i;
+  QUEUE* q;
 
-    if (q == &exit_message)
+  n = *(volatile unsigned int*) &nslots;
+  for (base = 0; workers[base] != self; base++);
+
+  for (i = 0; i < n; i++) {
+    if (!uv__work_runnable())
+      return NULL;
+
+    q = uv__worker_pop(workers[(base + i) % n]);
+    if (q != NULL)
+      return q;
+  }
+
+  return NULL;
+}
+
+
+static void uv__worker_wake(struct uv__worker* wk) {
+  uv_mutex_lock(&wk->mutex);
+  wk->wakeup = 1;
+  uv_cond_signal(&wk->cond);
+  uv_mutex_unlock(&wk->mutex);
+}
+
+
+/* Returns non-zero when the worker timed out without being handed work. */
+static int uv__worker_sleep(struct uv__worker* self) {
+  int timedout;
+
+  cmpxchgi(&self->sleeping, 0, 1);
+  xaddi(&nidle, 1);
+  timedout = 0;
+
+  /* Work that became runnable before we raised the flag isn't announced to
+   * us, look for it one more time. Everything that comes later is.
+   */
+  uv_mutex_lock(&self->mutex);
+  if (!uv__work_runnable() && stopping == 0)
+    while (self->wakeup == 0 && timedout == 0)
+      timedout = uv_cond_timedwait(&self->cond, &self->mutex, IDLE_TIMEOUT_NS);
+  self->wakeup = 0;
+  uv_mutex_unlock(&self->mutex);
+
+  /* Whoever lowers the flag accounts for it. */
+  if (cmpxchgi(&self->sleeping, 1, 0) == 1) {
+    xaddi(&nidle, -1);
+    return timedout != 0;
+  }
+
+  return 0;
+}
+
+
+/* Returns non-zero if the calling worker may exit. A retiring worker first
+ * gives up its place in nlive and then checks for work, submitters do it the
+ * other way around, so one of them always notices the other.
+ */
+static int uv__worker_retire(struct uv__worker* self) {
+  if (xaddi(&nlive, -1) <= *(volatile int*) &min_threads)
+    goto abort;
+
+  if (uv__work_runnable())
+    goto abort;
+
+  uv_mutex_lock(&self->mutex);
+  if (stopping) {
+    uv_mutex_unlock(&self->mutex);
+    goto abort;
+  }
+  self->live = 0;
+  pthread_detach(pthread_self());
+  uv_mutex_unlock(&self->mutex);
+  return 1;
+
+abort:
+  xaddi(&nlive, 1);
+  return 0;
+}
+
+
+/* Claims an idle worker, starting the search at |base|. The caller must wake
+ * the worker. Returns NULL when all workers are busy.
+ */
+static struct uv__worker* uv__worker_claim(unsigned int base) {
+  struct uv__worker* wk;
+  unsigned int n;
+  unsigned int i;
+
+  if (*(volatile int*) &nidle == 0)
+    return NULL;
+
+  n = *(volatile unsigned int*) &nslots;
+  for (i = 0; i < n; i++) {
+    wk = workers[(base + i) % n];
+    if (cmpxchgi(&wk->sleeping, 1, 0) == 1) {
+      xaddi(&nidle, -1);
+      return wk;
+    }
+  }
+
+  return NULL;
+}
+
+
+/* Hands finished work back to its loop. Completed requests go onto a
+ * lock-free LIFO that the loop empties in one go. Only the push that finds it
+ * empty wakes the loop, the ones that come after it ride along.
+ *
+ * The loop may run the done callback and be closed the moment the request
+ * is on the list, |completing| makes uv_loop_close() wait until we no longer
+ * touch it.
+ */
+static void uv__work_complete(struct uv__worker* self, struct uv__work* w) {
+  uv_loop_t* loop;
+  QUEUE* head;
+  QUEUE* seen;
+
+  loop = w->loop;
+  if (self != NULL)
+    ACCESS_ONCE(uv_loop_t*, self->completing) = loop;
+
+  head = NULL;
+  for (;;) {
+    ACCESS_ONCE(void*, w->wq[0]) = head;  /* QUEUE_NEXT */
+    seen = cmpxchgp(&loop->wq, head, &w->wq);
+    if (seen == head)
       break;
+    head = seen;
+  }
+
+  if (head == NULL)
+    uv_async_send(&loop->wq_async);
+
+  if (self != NULL)
+    ACCESS_ONCE(uv_loop_t*, self->completing) = NULL;
+}
+
+
+/* Nobody idle for |n| requests. Start up to that many threads, the busy ones
+ * may be stuck in a blocking call for a long time.
+ */
+static void uv__worker_grow(unsigned int n) {
+  while (n-- > 0 &&
+         *(volatile int*) &nlive < *(volatile int*) &max_threads)
+    uv__worker_spawn();
+}
+
+
+static void worker(void* arg) {
+  struct uv__worker* self;
+  struct uv__worker* wk;
+  struct uv__work* w;
+  unsigned int start;
+  unsigned int cls;
+  QUEUE* q;
+
+  self = arg;
+
+  for (;;) {
+    q = uv__worker_take(self);
+
+    if (q == NULL) {
+      if (stopping)
+        break;
+      if (*(volatile int*) &nlive > *(volatile int*) &max_threads ||
+          uv__worker_sleep(self))
+        if (uv__worker_retire(self))
+          break;
+      continue;
+    }
 
     w = QUEUE_DATA(q, struct uv__work, wq);
+    cls = w->cls;
+    start = uv__work_now();
+
+    /* Work is left behind and nobody is free to take it, get help. */
+    if (*(volatile int*) &nidle == 0 && uv__work_runnable())
+      uv__worker_grow(1);
+
+    if (w->tracked) {
+      uv__work_stats_queued(w, -1);
+      w->wait_time = start - w->queued_at;
+    }
+
     w->work(w);
 
-    uv_mutex_lock(&w->loop->wq_mutex);
-    w->work = NULL;  /* Signal uv_cancel() that the work req is done
-                        executing. */
-    QUEUE_INSERT_TAIL(&w->loop->wq, &w->wq);
-    uv_async_send(&w->loop->wq_async);
-    uv_mutex_unlock(&w->loop->wq_mutex);
+    if (w->tracked)
+      w->run_time = uv__work_now() - start;
+
+    /* Signal uv_cancel() that the work req is done executing. Must be
+     * visible before the request shows up on the completion list.
+     */
+    ACCESS_ONCE(uv__work_cb, w->work) = NULL;
+    uv__work_complete(self, w);
+
+    /* Work of this class may have been held back by the cap. We pick the next
+     * job by class order so get another worker to look at it.
+     */
+    xaddi(&running[cls], -1);
+    if (*(volatile int*) &queued[cls] > 0) {
+      wk = uv__worker_claim(next_worker);
+      if (wk != NULL)
+        uv__worker_wake(wk);
+    }
   }
 }
 
 
-static void post(QUEUE* q) {
-  uv_mutex_lock(&mutex);
-  QUEUE_INSERT_TAIL(&wq, q);
-  uv_cond_signal(&cond);
-  uv_mutex_unlock(&mutex);
+/* Pushes the chain |first| .. |last|, linked newest first, onto the inbox of
+ * |wk| in one go.
+ */
+static void uv__worker_push(struct uv__worker* wk, QUEUE* first, QUEUE* last) {
+  QUEUE* head;
+  QUEUE* seen;
+
+  head = NULL;
+  for (;;) {
+    QUEUE_NEXT(last) = head;
+    seen = cmpxchgp(&wk->inbox, head, first);
+    if (seen == head)
+      break;
+    head = seen;
+  }
 }
 
 
-static void init_once(void) {
+static unsigned int uv__worker_shard(struct uv__worker* wk) {
   unsigned int i;
-  const char* val;
 
-  nthreads = ARRAY_SIZE(default_threads);
-  val = getenv("UV_THREADPOOL_SIZE");
-  if (val != NULL)
-    nthreads = atoi(val);
-  if (nthreads == 0)
-    nthreads = 1;
-  if (nthreads > MAX_THREADPOOL_SIZE)
-    nthreads = MAX_THREADPOOL_SIZE;
-
-  threads = default_threads;
-  if (nthreads > ARRAY_SIZE(default_threads)) {
-    threads = malloc(nthreads * sizeof(threads[0]));
-    if (threads == NULL) {
-      nthreads = ARRAY_SIZE(default_threads);
-      threads = default_threads;
-    }
+  for (i = 0; workers[i] != wk; i++);
+  return i;
+}
+
+
+static void post(struct uv__work* w) {
+  struct uv__worker* wk;
+  unsigned int base;
+  unsigned int now;
+
+  now = uv__work_now();
+  w->queued_at = now;
+  xaddi(&queued[w->cls], 1);
+  base = xaddi(&next_worker, 1);
+
+  wk = uv__worker_claim(base);
+  if (wk == NULL) {
+    uv__worker_grow(1);
+    w->shard = base % *(volatile unsigned int*) &nslots;
+  } else {
+    w->shard = uv__worker_shard(wk);
   }
 
-  if (uv_cond_init(&cond))
-    abort();
+  uv__worker_push(workers[w->shard], &w->wq, &w->wq);
 
-  if (uv_mutex_init(&mutex))
-    abort();
+  if (wk != NULL)
+    uv__worker_wake(wk);
+}
 
-  QUEUE_INIT(&wq);
 
-  for (i = 0; i < nthreads; i++)
-    if (uv_thread_create(threads + i, worker, NULL))
-      abort();
+/* Posts the requests on |wq| at once. They are dealt out over as many idle
+ * workers as there are requests, each of which gets its share with a single
+ * push and is woken once. When nobody is idle everything goes to the next
+ * worker in line, the others steal from it when they come up for air.
+ */
+static void post_batch(QUEUE* wq) {
+  struct uv__worker* claimed[MAX_THREADPOOL_SIZE];
+  unsigned int shards[MAX_THREADPOOL_SIZE];
+  QUEUE* first[MAX_THREADPOOL_SIZE];
+  QUEUE* last[MAX_THREADPOOL_SIZE];
+  int nqueued[NCLASSES];
+  struct uv__work* w;
+  unsigned int nclaimed;
+  unsigned int ntargets;
+  unsigned int base;
+  unsigned int now;
+  unsigned int n;
+  unsigned int i;
+  QUEUE* q;
+
+  n = 0;
+  QUEUE_FOREACH(q, wq)
+    n++;
+
+  if (n == 0)
+    return;
+
+  now = uv__work_now();
+  memset(nqueued, 0, sizeof(nqueued));
+  QUEUE_FOREACH(q, wq) {
+    w = QUEUE_DATA(q, struct uv__work, wq);
+    w->queued_at = now;
+    nqueued[w->cls]++;
+  }
+
+  /* Account for the requests before anyone can pick them up. */
+  for (i = 0; i < NCLASSES; i++)
+    if (nqueued[i] != 0)
+      xaddi(&queued[i], nqueued[i]);
+
+  base = xaddi(&next_worker, 1);
+  nclaimed = 0;
+  while (nclaimed < n && nclaimed < MAX_THREADPOOL_SIZE) {
+    claimed[nclaimed] = uv__worker_claim(base + nclaimed);
+    if (claimed[nclaimed] == NULL)
+      break;
+    shards[nclaimed] = uv__worker_shard(claimed[nclaimed]);
+    nclaimed++;
+  }
+
+  if (nclaimed < n)
+    uv__worker_grow(n - nclaimed);
+
+  if (nclaimed == 0) {
+    shards[0] = base % *(volatile unsigned int*) &nslots;
+    ntargets = 1;
+  } else {
+    ntargets = nclaimed;
+  }
+
+  for (i = 0; i < ntargets; i++) {
+    first[i] = NULL;
+    last[i] = NULL;
+  }
+
+  /* The inbox is a LIFO, link every share newest first. */
+  for (i = 0; !QUEUE_EMPTY(wq); i = (i + 1) % ntargets) {
+    q = QUEUE_HEAD(wq);
+    QUEUE_REMOVE(q);
+    w = QUEUE_DATA(q, struct uv__work, wq);
+    w->shard = shards[i];
+    QUEUE_NEXT(q) = first[i];
+    first[i] = q;
+    if (last[i] == NULL)
+      last[i] = q;
+  }
+
+  for (i = 0; i < ntargets; i++)
+    if (first[i] != NULL)
+      uv__worker_push(workers[shards[i]], first[i], last[i]);
+
+  for (i = 0; i < nclaimed; i++)
+    uv__worker_wake(claimed[i]);
+}
+
+
+static void init_once(void) {
+  const char* val;
+
+  max_threads = 4;
+  val = getenv("UV_THREADPOOL_SIZE");
+  if (val != NULL)
+    max_threads = atoi(val);
+  if (max_threads <= 0)
+    max_threads = 1;
+  if (max_threads > MAX_THREADPOOL_SIZE)
+    max_threads = MAX_THREADPOOL_SIZE;
+  min_threads = 1;
+
+  if (uv_mutex_init(&spawn_mutex))
+    abort();
 
   initialized = 1;
 }
@@ -131,61 +675,188 @@ static void init_once(void) {
 
 UV_DESTRUCTOR(static void cleanup(void)) {
   unsigned int i;
+  int live;
 
   if (initialized == 0)
     return;
 
-  post(&exit_message);
+  uv_mutex_lock(&spawn_mutex);
+  stopping = 1;
+  uv_mutex_unlock(&spawn_mutex);
 
-  for (i = 0; i < nthreads; i++)
-    if (uv_thread_join(threads + i))
-      abort();
+  for (i = 0; i < nslots; i++)
+    uv__worker_wake(workers[i]);
 
-  if (threads != default_threads)
-    free(threads);
+  for (i = 0; i < nslots; i++) {
+    uv_mutex_lock(&workers[i]->mutex);
+    live = workers[i]->live;
+    uv_mutex_unlock(&workers[i]->mutex);
+
+    if (live && uv_thread_join(&workers[i]->thread))
+      abort();
+  }
 
-  uv_mutex_destroy(&mutex);
-  uv_cond_destroy(&cond);
+  for (i = 0; i < nslots; i++) {
+    uv_mutex_destroy(&workers[i]->mutex);
+    uv_cond_destroy(&workers[i]->cond);
+    free(workers[i]);
+    workers[i] = NULL;
+  }
 
-  threads = NULL;
-  nthreads = 0;
+  uv_mutex_destroy(&spawn_mutex);
+  nslots = 0;
+  nlive = 0;
   initialized = 0;
 }
 
 
+int uv_threadpool_set_limits(unsigned int min, unsigned int max) {
+  int n;
+
+  if (min > max || max == 0 || max > MAX_THREADPOOL_SIZE)
+    return -EINVAL;
+
+  uv_once(&once, init_once);
+
+  uv_mutex_lock(&spawn_mutex);
+  min_threads = min;
+  max_threads = max;
+  uv_mutex_unlock(&spawn_mutex);
+
+  /* Surplus threads notice when they run out of work. */
+  for (n = *(volatile int*) &nlive; n < (int) min; n++)
+    uv__worker_spawn();
+
+  return 0;
+}
+
+
 void uv__work_submit(uv_loop_t* loop,
                      struct uv__work* w,
+                     uv_work_class cls,
+                     unsigned int type,
                      void (*work)(struct uv__work* w),
                      void (*done)(struct uv__work* w, int status)) {
+  uv_threadpool_stats_t* stats;
+
   uv_once(&once, init_once);
   w->loop = loop;
+  w->cls = cls;
+  w->type = type;
   w->work = work;
   w->done = done;
-  post(&w->wq);
+
+  stats = loop->wq_stats;
+  w->tracked = (stats != NULL);
+  if (w->tracked) {
+    stats->types[type].submitted++;
+    xaddi((int*) &global_stats.types[type].submitted, 1);
+    uv__work_stats_queued(w, 1);
+  }
+
+  if (loop->wq_batch_depth > 0) {
+    w->shard = BATCHED_SHARD;
+    QUEUE_INSERT_TAIL(&loop->wq_batch, &w->wq);
+    return;
+  }
+
+  post(w);
+}
+
+
+void uv_work_batch_begin(uv_loop_t* loop) {
+  loop->wq_batch_depth++;
+}
+
+
+void uv_work_batch_end(uv_loop_t* loop) {
+  assert(loop->wq_batch_depth > 0);
+  if (--loop->wq_batch_depth == 0)
+    post_batch(&loop->wq_batch);
+}
+
+
+/* Waits for workers that may still touch |loop| after handing it the last
+ * request.
+ */
+void uv__work_loop_close(uv_loop_t* loop) {
+  unsigned int i;
+
+  if (initialized == 0)
+    return;
+
+  for (i = 0; i < *(volatile unsigned int*) &nslots; i++)
+    while (ACCESS_ONCE(uv_loop_t*, workers[i]->completing) == loop)
+      sched_yield();
+}
+
+
+int uv__work_stats_init(uv_loop_t* loop) {
+  if (loop->wq_stats == NULL) {
+    loop->wq_stats = calloc(1, sizeof(uv_threadpool_stats_t));
+    if (loop->wq_stats == NULL)
+      return -ENOMEM;
+  }
+
+  return 0;
+}
+
+
+int uv_threadpool_stats(uv_loop_t* loop, uv_threadpool_stats_t* stats) {
+  if (loop == NULL)
+    memcpy(stats, &global_stats, sizeof(*stats));
+  else if (loop->wq_stats != NULL)
+    memcpy(stats, loop->wq_stats, sizeof(*stats));
+  else
+    return -ENOENT;
+
+  stats->threads = *(volatile int*) &nlive;
+  stats->idle_threads = *(volatile int*) &nidle;
+  return 0;
 }
 
 
 static int uv__work_cancel(uv_loop_t* loop, uv_req_t* req, struct uv__work* w) {
+  struct uv__worker* wk;
   int cancelled;
 
-  uv_mutex_lock(&mutex);
-  uv_mutex_lock(&w->loop->wq_mutex);
+  /* Finished, on the io_uring where it can't be taken back, or cancelled
+   * already and on its way to the done callback.
+   */
+  if (w->work == NULL || w->work == uv__cancelled)
+    return -EBUSY;
 
-  cancelled = !QUEUE_EMPTY(&w->wq) && w->work != NULL;
-  if (cancelled)
+  /* Still in the batch, the loop thread is the only one that knows of it. */
+  if (w->shard == BATCHED_SHARD) {
     QUEUE_REMOVE(&w->wq);
+    goto cancelled;
+  }
+
+  wk = workers[w->shard];
 
-  uv_mutex_unlock(&w->loop->wq_mutex);
-  uv_mutex_unlock(&mutex);
+  /* Queued requests are linked into a queue of the worker. A worker that
+   * takes one unlinks it, when it's done it clears |work| and only then
+   * links the request into the completion list. Look in the same order.
+   */
+  uv_mutex_lock(&wk->mutex);
+  uv__worker_drain(wk);
+  cancelled = ACCESS_ONCE(void*, w->wq[0]) != (void*) &w->wq &&
+              ACCESS_ONCE(uv__work_cb, w->work) != NULL;
+  if (cancelled)
+    QUEUE_REMOVE(&w->wq);
+  uv_mutex_unlock(&wk->mutex);
 
   if (!cancelled)
     return -EBUSY;
 
+  xaddi(&queued[w->cls], -1);
+
+cancelled:
+  if (w->tracked)
+    uv__work_stats_queued(w, -1);
+
   w->work = uv__cancelled;
-  uv_mutex_lock(&loop->wq_mutex);
-  QUEUE_INSERT_TAIL(&loop->wq, &w->wq);
-  uv_async_send(&loop->wq_async);
-  uv_mutex_unlock(&loop->wq_mutex);
+  uv__work_complete(NULL, w);
 
   return 0;
 }
@@ -194,19 +865,25 @@ static int uv__work_cancel(uv_loop_t* loop, uv_req_t* req, struct uv__work* w) {
 void uv__work_done(uv_async_t* handle) {
   struct uv__work* w;
   uv_loop_t* loop;
+  QUEUE* head;
+  QUEUE* seen;
   QUEUE* q;
   QUEUE wq;
   int err;
 
   loop = container_of(handle, uv_loop_t, wq_async);
-  QUEUE_INIT(&wq);
 
-  uv_mutex_lock(&loop->wq_mutex);
-  if (!QUEUE_EMPTY(&loop->wq)) {
-    q = QUEUE_HEAD(&loop->wq);
-    QUEUE_SPLIT(&loop->wq, q, &wq);
+  head = NULL;
+  while ((seen = cmpxchgp(&loop->wq, head, NULL)) != head)
+    head = seen;
+
+  /* Newest first, turn it around. */
+  QUEUE_INIT(&wq);
+  while (head != NULL) {
+    q = head;
+    head = QUEUE_NEXT(q);
+    QUEUE_INSERT_HEAD(&wq, q);
   }
-  uv_mutex_unlock(&loop->wq_mutex);
 
   while (!QUEUE_EMPTY(&wq)) {
     q = QUEUE_HEAD(&wq);
@@ -214,6 +891,8 @@ void uv__work_done(uv_async_t* handle) {
 
     w = container_of(q, struct uv__work, wq);
     err = (w->work == uv__cancelled) ? -ECANCELED : 0;
+    if (w->tracked)
+      uv__work_stats_done(loop, w, err);
     w->done(w, err);
   }
 }
@@ -243,14 +922,48 @@ int uv_queue_work(uv_loop_t* loop,
                   uv_work_t* req,
                   uv_work_cb work_cb,
                   uv_after_work_cb after_work_cb) {
-  if (work_cb == NULL)
+  return uv_queue_work_class(loop, req, UV_WORK_USER, work_cb, after_work_cb);
+}
+
+
+int uv_queue_work_batch(uv_loop_t* loop,
+                        uv_work_t* reqs[],
+                        unsigned int nreqs,
+                        uv_work_class cls,
+                        uv_work_cb work_cb,
+                        uv_after_work_cb after_work_cb) {
+  unsigned int i;
+
+  if (work_cb == NULL || (unsigned int) cls >= NCLASSES)
+    return -EINVAL;
+
+  uv_work_batch_begin(loop);
+  for (i = 0; i < nreqs; i++)
+    uv_queue_work_class(loop, reqs[i], cls, work_cb, after_work_cb);
+  uv_work_batch_end(loop);
+
+  return 0;
+}
+
+
+int uv_queue_work_class(uv_loop_t* loop,
+                        uv_work_t* req,
+                        uv_work_class cls,
+                        uv_work_cb work_cb,
+                        uv_after_work_cb after_work_cb) {
+  if (work_cb == NULL || (unsigned int) cls >= NCLASSES)
     return -EINVAL;
 
   uv__req_init(loop, req, UV_WORK);
   req->loop = loop;
   req->work_cb = work_cb;
   req->after_work_cb = after_work_cb;
-  uv__work_submit(loop, &req->work_req, uv__queue_work, uv__queue_done);
+  uv__work_submit(loop,
+                  &req->work_req,
+                  cls,
+                  UV_THREADPOOL_STATS_WORK,
+                  uv__queue_work,
+                  uv__queue_done);
   return 0;
 }
 
@@ -24,6 +24,33 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <stdlib.h>
+
+/* The timer wheel, see UV_LOOP_TIMER_WHEEL. Level 0 has a slot for each of
+ * the next 64 milliseconds, level 1 for each of the next 64 blocks of 64
+ * milliseconds and so on. A timer sits in the lowest level where its
+ * expiry and the wheel's current tick agree on all the higher bits, timers
+ * that are further out than the top level wait in the overflow list. When the
+ * current tick enters the block of a slot on a higher level, the slot is
+ * cascaded: its timers are moved down, in order. Timers due at the same time
+ * therefore always share a slot and fire in the order they were started in.
+ */
+#define UV__TIMER_WHEEL_BITS 6
+#define UV__TIMER_WHEEL_SIZE (1 << UV__TIMER_WHEEL_BITS)
+#define UV__TIMER_WHEEL_MASK (UV__TIMER_WHEEL_SIZE - 1)
+#define UV__TIMER_WHEEL_LEVELS 5
+
+struct uv__timer_wheel {
+  uint64_t now;  /* The tick that's being expired, earlier ones are done. */
+  uint64_t occupied[UV__TIMER_WHEEL_LEVELS];  /* A bit per non-empty slot. */
+  QUEUE due;  /* Started with an expiry before |now|. */
+  QUEUE overflow;
+  QUEUE slots[UV__TIMER_WHEEL_LEVELS][UV__TIMER_WHEEL_SIZE];
+};
+
+/* On a wheel, heap_node holds the list links and the list the timer is on. */
+#define uv__timer_queue(handle) ((QUEUE*) &(handle)->heap_node)
+#define uv__timer_bucket(handle) ((QUEUE*) (handle)->heap_node[2])
 
 
 static int timer_less_than(const struct heap_node* ha,
@@ -51,6 +78,230 @@ static int timer_less_than(const struct heap_node* ha,
 }
 
 
+static unsigned int uv__timer_ctz(uint64_t v) {
+#if defined(__GNUC__)
+  return __builtin_ctzll(v);
+#else
+  unsigned int n;
+
+  for (n = 0; (v & 1) == 0; n++)
+    v >>= 1;
+
+  return n;
+#endif
+}
+
+
+static int uv__timer_wheel_is_slot(struct uv__timer_wheel* wheel, QUEUE* q) {
+  return q >= &wheel->slots[0][0] &&
+         q <= &wheel->slots[UV__TIMER_WHEEL_LEVELS - 1][UV__TIMER_WHEEL_MASK];
+}
+
+
+static void uv__timer_wheel_insert(struct uv__timer_wheel* wheel,
+                                   uv_timer_t* handle) {
+  unsigned int level;
+  unsigned int slot;
+  unsigned int shift;
+  QUEUE* bucket;
+
+  if (handle->timeout < wheel->now) {
+    bucket = &wheel->due;
+  } else {
+    bucket = &wheel->overflow;
+
+    for (level = 0; level < UV__TIMER_WHEEL_LEVELS; level++) {
+      shift = (level + 1) * UV__TIMER_WHEEL_BITS;
+      if ((handle->timeout >> shift) != (wheel->now >> shift))
+        continue;
+
+      slot = (handle->timeout >> (level * UV__TIMER_WHEEL_BITS)) &
+             UV__TIMER_WHEEL_MASK;
+      bucket = &wheel->slots[level][slot];
+      wheel->occupied[level] |= (uint64_t) 1 << slot;
+      break;
+    }
+  }
+
+  QUEUE_INSERT_TAIL(bucket, uv__timer_queue(handle));
+  handle->heap_node[2] = bucket;
+}
+
+
+static void uv__timer_wheel_remove(struct uv__timer_wheel* wheel,
+                                   uv_timer_t* handle) {
+  unsigned int n;
+  QUEUE* bucket;
+
+  bucket = uv__timer_bucket(handle);
+  QUEUE_REMOVE(uv__timer_queue(handle));
+
+  if (QUEUE_EMPTY(bucket) && uv__timer_wheel_is_slot(wheel, bucket)) {
+    n = bucket - &wheel->slots[0][0];
+    wheel->occupied[n / UV__TIMER_WHEEL_SIZE] &=
+        ~((uint64_t) 1 << (n % UV__TIMER_WHEEL_SIZE));
+  }
+}
+
+
+static void uv__timer_wheel_cascade(struct uv__timer_wheel* wheel,
+                                    QUEUE* bucket) {
+  unsigned int n;
+  QUEUE* last;
+  QUEUE* q;
+
+  if (QUEUE_EMPTY(bucket))
+    return;
+
+  if (uv__timer_wheel_is_slot(wheel, bucket)) {
+    n = bucket - &wheel->slots[0][0];
+    wheel->occupied[n / UV__TIMER_WHEEL_SIZE] &=
+        ~((uint64_t) 1 << (n % UV__TIMER_WHEEL_SIZE));
+  }
+
+  /* Timers from the overflow list can end up right back on it. */
+  last = QUEUE_PREV(bucket);
+  do {
+    q = QUEUE_HEAD(bucket);
+    QUEUE_REMOVE(q);
+    uv__timer_wheel_insert(wheel, QUEUE_DATA(q, uv_timer_t, heap_node));
+  } while (q != last);
+}
+
+
+/* Returns the first tick after |now| where something happens: a level 0 slot
+ * expires or a slot on a higher level is cascaded. Only valid when the level 0
+ * slot of |now| is empty.
+ */
+static uint64_t uv__timer_wheel_next(const struct uv__timer_wheel* wheel,
+                                     unsigned int* plevel) {
+  unsigned int level;
+  unsigned int shift;
+  unsigned int idx;
+  uint64_t bits;
+
+  for (level = 0; level < UV__TIMER_WHEEL_LEVELS; level++) {
+    shift = level * UV__TIMER_WHEEL_BITS;
+    idx = (wheel->now >> shift) & UV__TIMER_WHEEL_MASK;
+    bits = wheel->occupied[level] & ~(((uint64_t) 2 << idx) - 1);
+    if (bits == 0)
+      continue;
+
+    *plevel = level;
+    shift += UV__TIMER_WHEEL_BITS;
+    return (wheel->now >> shift << shift) |
+           ((uint64_t) uv__timer_ctz(bits) << (level * UV__TIMER_WHEEL_BITS));
+  }
+
+  *plevel = level;
+  shift = UV__TIMER_WHEEL_LEVELS * UV__TIMER_WHEEL_BITS;
+  return ((wheel->now >> shift) + 1) << shift;
+}
+
+
+/* Moves the wheel forward to the first tick up to and including |time| that
+ * has timers, and returns their slot. Returns NULL when there is none.
+ */
+static QUEUE* uv__timer_wheel_advance(struct uv__timer_wheel* wheel,
+                                      uint64_t time) {
+  unsigned int level;
+  uint64_t next;
+  QUEUE* slot;
+
+  for (;;) {
+    if (wheel->now > time)
+      return NULL;
+
+    slot = &wheel->slots[0][wheel->now & UV__TIMER_WHEEL_MASK];
+    if (!QUEUE_EMPTY(slot))
+      return slot;
+
+    next = uv__timer_wheel_next(wheel, &level);
+    if (next > time + 1) {
+      /* Nothing happens on the way, skip ahead. */
+      wheel->now = time + 1;
+      return NULL;
+    }
+
+    wheel->now = next;
+
+    /* Top down, higher levels cascade into lower ones. */
+    for (level = UV__TIMER_WHEEL_LEVELS; level > 0; level--) {
+      if (next & (((uint64_t) 1 << (level * UV__TIMER_WHEEL_BITS)) - 1))
+        continue;
+
+      if (level == UV__TIMER_WHEEL_LEVELS)
+        uv__timer_wheel_cascade(wheel, &wheel->overflow);
+      else
+        uv__timer_wheel_cascade(wheel,
+                                &wheel->slots[level][(next >> (level *
+                                    UV__TIMER_WHEEL_BITS)) &
+                                    UV__TIMER_WHEEL_MASK]);
+    }
+  }
+}
+
+
+/* Returns the tick the loop has to wake up at, or 0 when the wheel is empty.
+ * When the nearest timers are on a higher level, that's the tick their slot
+ * is cascaded at rather than their expiry, scanning the slot would cost as
+ * much as the heap does.
+ */
+static int uv__timer_wheel_min(const struct uv__timer_wheel* wheel,
+                               uint64_t* expiry) {
+  unsigned int level;
+  uint64_t next;
+
+  if (!QUEUE_EMPTY(&wheel->due)) {
+    *expiry = 0;
+    return 1;
+  }
+
+  if (!QUEUE_EMPTY(&wheel->slots[0][wheel->now & UV__TIMER_WHEEL_MASK])) {
+    *expiry = wheel->now;
+    return 1;
+  }
+
+  next = uv__timer_wheel_next(wheel, &level);
+  if (level == UV__TIMER_WHEEL_LEVELS && QUEUE_EMPTY(&wheel->overflow))
+    return 0;
+
+  *expiry = next;
+  return 1;
+}
+
+
+int uv__timer_wheel_init(uv_loop_t* loop) {
+  struct uv__timer_wheel* wheel;
+  unsigned int level;
+  unsigned int slot;
+
+  if (loop->timer_wheel != NULL)
+    return 0;
+
+  /* Timers don't move between the heap and the wheel. */
+  if (heap_min((const struct heap*) &loop->timer_heap) != NULL)
+    return -EBUSY;
+
+  wheel = malloc(sizeof(*wheel));
+  if (wheel == NULL)
+    return -ENOMEM;
+
+  wheel->now = loop->time;
+  QUEUE_INIT(&wheel->due);
+  QUEUE_INIT(&wheel->overflow);
+
+  for (level = 0; level < UV__TIMER_WHEEL_LEVELS; level++) {
+    wheel->occupied[level] = 0;
+    for (slot = 0; slot < UV__TIMER_WHEEL_SIZE; slot++)
+      QUEUE_INIT(&wheel->slots[level][slot]);
+  }
+
+  loop->timer_wheel = wheel;
+  return 0;
+}
+
+
 int uv_timer_init(uv_loop_t* loop, uv_timer_t* handle) {
   uv__handle_init(loop, (uv_handle_t*)handle, UV_TIMER);
   handle->timer_cb = NULL;
@@ -78,9 +329,12 @@ int uv_timer_start(uv_timer_t* handle,
   /* start_id is the second index to be compared in uv__timer_cmp() */
   handle->start_id = handle->loop->timer_counter++;
 
-  heap_insert((struct heap*) &handle->loop->timer_heap,
-              (struct heap_node*) &handle->heap_node,
-              timer_less_than);
+  if (handle->loop->timer_wheel != NULL)
+    uv__timer_wheel_insert(handle->loop->timer_wheel, handle);
+  else
+    heap_insert((struct heap*) &handle->loop->timer_heap,
+                (struct heap_node*) &handle->heap_node,
+                timer_less_than);
   uv__handle_start(handle);
 
   return 0;
@@ -91,9 +345,12 @@ int uv_timer_stop(uv_timer_t* handle) {
   if (!uv__is_active(handle))
     return 0;
 
-  heap_remove((struct heap*) &handle->loop->timer_heap,
-              (struct heap_node*) &handle->heap_node,
-              timer_less_than);
+  if (handle->loop->timer_wheel != NULL)
+    uv__timer_wheel_remove(handle->loop->timer_wheel, handle);
+  else
+    heap_remove((struct heap*) &handle->loop->timer_heap,
+                (struct heap_node*) &handle->heap_node,
+                timer_less_than);
   uv__handle_stop(handle);
 
   return 0;
@@ -126,17 +383,33 @@ uint64_t uv_timer_get_repeat(const uv_timer_t* handle) {
 int uv__next_timeout(const uv_loop_t* loop) {
   const struct heap_node* heap_node;
   const uv_timer_t* handle;
+  uint64_t timeout;
+  uint64_t slack;
   uint64_t diff;
 
-  heap_node = heap_min((const struct heap*) &loop->timer_heap);
-  if (heap_node == NULL)
-    return -1; /* block indefinitely */
+  if (loop->timer_wheel != NULL) {
+    if (!uv__timer_wheel_min(loop->timer_wheel, &timeout))
+      return -1; /* block indefinitely */
+  } else {
+    heap_node = heap_min((const struct heap*) &loop->timer_heap);
+    if (heap_node == NULL)
+      return -1; /* block indefinitely */
 
-  handle = container_of(heap_node, const uv_timer_t, heap_node);
-  if (handle->timeout <= loop->time)
+    handle = container_of(heap_node, const uv_timer_t, heap_node);
+    timeout = handle->timeout;
+  }
+
+  if (timeout <= loop->time)
     return 0;
 
-  diff = handle->timeout - loop->time;
+  /* Round up to the slack boundary, timers due in the same window then
+   * expire together when the loop wakes up at its end.
+   */
+  slack = loop->timer_slack;
+  if (slack != 0 && timeout <= (uint64_t) -1 - slack)
+    timeout = (timeout + slack - 1) / slack * slack;
+
+  diff = timeout - loop->time;
   if (diff > INT_MAX)
     diff = INT_MAX;
 
@@ -144,10 +417,39 @@ int uv__next_timeout(const uv_loop_t* loop) {
 }
 
 
+static void uv__timer_wheel_run(uv_loop_t* loop,
+                                struct uv__timer_wheel* wheel) {
+  uv_timer_t* handle;
+  QUEUE* slot;
+  QUEUE* q;
+
+  for (;;) {
+    if (QUEUE_EMPTY(&wheel->due)) {
+      slot = uv__timer_wheel_advance(wheel, loop->time);
+      if (slot == NULL)
+        break;
+      q = QUEUE_HEAD(slot);
+    } else {
+      q = QUEUE_HEAD(&wheel->due);
+    }
+
+    handle = QUEUE_DATA(q, uv_timer_t, heap_node);
+    uv_timer_stop(handle);
+    uv_timer_again(handle);
+    handle->timer_cb(handle);
+  }
+}
+
+
 void uv__run_timers(uv_loop_t* loop) {
   struct heap_node* heap_node;
   uv_timer_t* handle;
 
+  if (loop->timer_wheel != NULL) {
+    uv__timer_wheel_run(loop, loop->timer_wheel);
+    return;
+  }
+
   for (;;) {
     heap_node = heap_min((struct heap*) &loop->timer_heap);
     if (heap_node == NULL)
@@ -36,6 +36,45 @@
 # define IPV6_DROP_MEMBERSHIP IPV6_LEAVE_GROUP
 #endif
 
+#if defined(__linux__)
+# define UV__MMSG_MAXWIDTH 20
+# define UV__MMSG_MINWIDTH 2
+# define UV__MMSG_CHUNK (64 * 1024)
+# define UV__MMSG_SHRINK_INTERVAL 64  /* recvmmsg() calls. */
+
+# ifndef SOL_UDP
+#  define SOL_UDP 17
+# endif
+# define UV__UDP_SEGMENT 103
+# define UV__UDP_GRO 104
+
+/* Room for one UDP_SEGMENT or UDP_GRO control message. */
+union uv__udp_cmsg_u {
+  char buf[CMSG_SPACE(sizeof(int))];
+  size_t align;  /* Same alignment as struct cmsghdr. */
+};
+
+/* Lazily allocated on the first batched receive and shared by all UDP handles
+ * of the loop. The datagrams are handed to recv_cb before the next call, so a
+ * single set of buffers is enough.
+ *
+ * A chunk has to fit the largest datagram but most of the time a batch holds
+ * only a few, so there are just |width| chunks. The batch starts out small,
+ * doubles when a call fills it and halves again when it's been less than half
+ * full for UV__MMSG_SHRINK_INTERVAL calls.
+ */
+struct uv__udp_mmsg_s {
+  struct uv__mmsghdr msgs[UV__MMSG_MAXWIDTH];
+  struct iovec iov[UV__MMSG_MAXWIDTH];
+  struct sockaddr_storage peers[UV__MMSG_MAXWIDTH];
+  union uv__udp_cmsg_u ctl[UV__MMSG_MAXWIDTH];
+  unsigned int width;
+  unsigned int peak;   /* Most datagrams in a call since the last resize. */
+  unsigned int calls;  /* Calls since the last resize. */
+  /* Followed by |width| chunks of UV__MMSG_CHUNK bytes. */
+};
+#endif
+
 
 static void uv__udp_run_completed(uv_udp_t* handle);
 static void uv__udp_io(uv_loop_t* loop, uv__io_t* w, unsigned int revents);
@@ -140,27 +179,256 @@ static void uv__udp_io(uv_loop_t* loop, uv__io_t* w, unsigned int revents) {
 }
 
 
+#if defined(__linux__)
+static unsigned int uv__udp_gro_size(struct msghdr* h) {
+  struct cmsghdr* cmsg;
+  int size;
+
+  for (cmsg = CMSG_FIRSTHDR(h); cmsg != NULL; cmsg = CMSG_NXTHDR(h, cmsg)) {
+    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UV__UDP_GRO) {
+      memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+      return size;
+    }
+  }
+
+  return 0;
+}
+#endif
+
+
+static void uv__udp_prep_send(struct msghdr* h,
+                              uv_udp_send_t* req,
+                              void* ctl) {
+#if defined(__linux__)
+  struct cmsghdr* cmsg;
+  uint16_t segment_size;
+#endif
+
+  memset(h, 0, sizeof(*h));
+  h->msg_name = &req->addr;
+  h->msg_namelen = (req->addr.ss_family == AF_INET6 ?
+    sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+  h->msg_iov = (struct iovec*) req->bufs;
+  h->msg_iovlen = req->nbufs;
+
+#if defined(__linux__)
+  if (req->segment_size == 0)
+    return;
+
+  segment_size = req->segment_size;
+  h->msg_control = ctl;
+  h->msg_controllen = CMSG_SPACE(sizeof(segment_size));
+  cmsg = CMSG_FIRSTHDR(h);
+  cmsg->cmsg_level = SOL_UDP;
+  cmsg->cmsg_type = UV__UDP_SEGMENT;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(segment_size));
+  memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+#endif
+}
+
+
+#if defined(__linux__)
+static int uv__udp_mmsg_resize(uv_loop_t* loop, unsigned int width) {
+  struct uv__udp_mmsg_s* m;
+
+  m = realloc(loop->udp_mmsg, sizeof(*m) + width * UV__MMSG_CHUNK);
+  if (m == NULL)
+    return -ENOMEM;
+
+  m->width = width;
+  m->peak = 0;
+  m->calls = 0;
+  loop->udp_mmsg = m;
+  return 0;
+}
+
+
+/* Fits the batch to the traffic after a call that returned |nmsgs|. */
+static void uv__udp_mmsg_adapt(uv_loop_t* loop, unsigned int nmsgs) {
+  struct uv__udp_mmsg_s* m;
+  unsigned int width;
+
+  m = loop->udp_mmsg;
+  width = m->width;
+
+  if (nmsgs > m->peak)
+    m->peak = nmsgs;
+
+  if (nmsgs == width) {
+    width *= 2;
+    if (width > UV__MMSG_MAXWIDTH)
+      width = UV__MMSG_MAXWIDTH;
+  } else if (++m->calls == UV__MMSG_SHRINK_INTERVAL) {
+    if (2 * m->peak < width)
+      width /= 2;
+    if (width < UV__MMSG_MINWIDTH)
+      width = UV__MMSG_MINWIDTH;
+    m->peak = 0;
+    m->calls = 0;
+  }
+
+  /* Keeps the current batch if realloc() fails. */
+  if (width != m->width)
+    uv__udp_mmsg_resize(loop, width);
+}
+
+
+static int uv__udp_recvmmsg(uv_udp_t* handle) {
+  struct uv__udp_mmsg_s* m;
+  struct msghdr* h;
+  const struct sockaddr* addr;
+  uv_buf_t buf;
+  int flags;
+  int nmsgs;
+  int count;
+  int i;
+
+  if (handle->loop->udp_mmsg == NULL)
+    if (uv__udp_mmsg_resize(handle->loop, UV__MMSG_MINWIDTH))
+      return -ENOMEM;
+
+  count = 32;
+
+  do {
+    m = handle->loop->udp_mmsg;
+    for (i = 0; i < (int) m->width; i++) {
+      m->iov[i].iov_base = (char*) (m + 1) + i * UV__MMSG_CHUNK;
+      m->iov[i].iov_len = UV__MMSG_CHUNK;
+      h = &m->msgs[i].msg_hdr;
+      memset(h, 0, sizeof(*h));
+      h->msg_name = &m->peers[i];
+      h->msg_namelen = sizeof(m->peers[i]);
+      h->msg_iov = &m->iov[i];
+      h->msg_iovlen = 1;
+      if (handle->flags & UV_HANDLE_UDP_GRO) {
+        h->msg_control = &m->ctl[i];
+        h->msg_controllen = sizeof(m->ctl[i]);
+      }
+    }
+
+    do {
+      nmsgs = uv__recvmmsg(handle->io_watcher.fd,
+                           m->msgs,
+                           m->width,
+                           0,
+                           NULL);
+    }
+    while (nmsgs == -1 && errno == EINTR);
+
+    if (nmsgs == -1) {
+      /* Not implemented by the kernel, let the caller fall back to recvmsg(). */
+      if (errno == ENOSYS)
+        return -ENOSYS;
+
+      buf = uv_buf_init(NULL, 0);
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        uv__io_drained(&handle->io_watcher, UV__POLLIN);
+        handle->recv_cb(handle, 0, &buf, NULL, UV_UDP_MMSG_CHUNK);
+      }
+      else
+        handle->recv_cb(handle, -errno, &buf, NULL, UV_UDP_MMSG_CHUNK);
+
+      return 0;
+    }
+
+    handle->recv_mmsg_count = nmsgs;
+
+    /* recv_cb callback may decide to pause or close the handle, the remaining
+     * datagrams of the batch are dropped when it does.
+     */
+    for (i = 0;
+         i < nmsgs && handle->io_watcher.fd != -1 && handle->recv_cb != NULL;
+         i++) {
+      h = &m->msgs[i].msg_hdr;
+      if (h->msg_namelen == 0)
+        addr = NULL;
+      else
+        addr = (const struct sockaddr*) &m->peers[i];
+
+      flags = UV_UDP_MMSG_CHUNK;
+      if (h->msg_flags & MSG_TRUNC)
+        flags |= UV_UDP_PARTIAL;
+
+      handle->recv_segment_size = 0;
+      if (handle->flags & UV_HANDLE_UDP_GRO)
+        handle->recv_segment_size = uv__udp_gro_size(h);
+
+      buf = uv_buf_init((char*) (m + 1) + i * UV__MMSG_CHUNK,
+                        m->msgs[i].msg_len);
+      handle->recv_cb(handle, m->msgs[i].msg_len, &buf, addr, flags);
+    }
+
+    uv__udp_mmsg_adapt(handle->loop, nmsgs);
+    count -= nmsgs;
+  }
+  while (count > 0
+      && handle->io_watcher.fd != -1
+      && handle->recv_cb != NULL);
+
+  return 0;
+}
+#endif
+
+
 static void uv__udp_recvmsg(uv_udp_t* handle) {
   struct sockaddr_storage peer;
+#if defined(__linux__)
+  union uv__udp_cmsg_u ctl;
+#endif
   struct msghdr h;
+  uv_loop_t* loop;
   ssize_t nread;
   uv_buf_t buf;
+  int pooled;
   int flags;
   int count;
 
   assert(handle->recv_cb != NULL);
-  assert(handle->alloc_cb != NULL);
+  assert(handle->alloc_cb != NULL || uv__read_pool_enabled(handle->loop));
+
+#if defined(__linux__)
+  if (handle->flags & UV_HANDLE_UDP_RECVMMSG) {
+    int err;
+
+    err = uv__udp_recvmmsg(handle);
+    if (err == 0)
+      return;
+
+    if (err == -ENOSYS)
+      handle->flags &= ~UV_HANDLE_UDP_RECVMMSG;
+    else {
+      buf = uv_buf_init(NULL, 0);
+      handle->recv_cb(handle, err, &buf, NULL, UV_UDP_MMSG_CHUNK);
+      return;
+    }
+  }
+#endif
 
   /* Prevent loop starvation when the data comes in as fast as (or faster than)
-   * we can read it. XXX Need to rearm fd if we switch to edge-triggered I/O.
+   * we can read it. Edge-triggered watchers that stop short of EAGAIN are
+   * rearmed by uv__io_poll().
    */
   count = 32;
 
   memset(&h, 0, sizeof(h));
   h.msg_name = &peer;
 
+  /* The recv callback may close the handle, see uv__read(). */
+  loop = handle->loop;
+
   do {
-    handle->alloc_cb((uv_handle_t*) handle, 64 * 1024, &buf);
+    /* Pooled only without an alloc_cb. Datagrams get the largest size class,
+     * anything smaller would truncate them.
+     */
+    pooled = (handle->alloc_cb == NULL);
+
+    if (pooled) {
+      if (uv__read_pool_get(loop, UV__READ_POOL_CLASSES - 1, &buf))
+        buf = uv_buf_init(NULL, 0);
+    } else {
+      handle->alloc_cb((uv_handle_t*) handle, 64 * 1024, &buf);
+    }
+
     if (buf.len == 0) {
       handle->recv_cb(handle, UV_ENOBUFS, &buf, NULL, 0);
       return;
@@ -170,6 +438,12 @@ static void uv__udp_recvmsg(uv_udp_t* handle) {
     h.msg_namelen = sizeof(peer);
     h.msg_iov = (void*) &buf;
     h.msg_iovlen = 1;
+#if defined(__linux__)
+    if (handle->flags & UV_HANDLE_UDP_GRO) {
+      h.msg_control = &ctl;
+      h.msg_controllen = sizeof(ctl);
+    }
+#endif
 
     do {
       nread = recvmsg(handle->io_watcher.fd, &h, 0);
@@ -177,8 +451,10 @@ static void uv__udp_recvmsg(uv_udp_t* handle) {
     while (nread == -1 && errno == EINTR);
 
     if (nread == -1) {
-      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        uv__io_drained(&handle->io_watcher, UV__POLLIN);
         handle->recv_cb(handle, 0, &buf, NULL, 0);
+      }
       else
         handle->recv_cb(handle, -errno, &buf, NULL, 0);
     }
@@ -193,8 +469,17 @@ static void uv__udp_recvmsg(uv_udp_t* handle) {
       if (h.msg_flags & MSG_TRUNC)
         flags |= UV_UDP_PARTIAL;
 
+#if defined(__linux__)
+      handle->recv_segment_size = 0;
+      if (handle->flags & UV_HANDLE_UDP_GRO)
+        handle->recv_segment_size = uv__udp_gro_size(&h);
+#endif
+
       handle->recv_cb(handle, nread, &buf, addr, flags);
     }
+
+    if (pooled)
+      uv__read_pool_put(loop, &buf);
   }
   /* recv_cb callback may decide to pause or close the handle */
   while (nread != -1
@@ -204,11 +489,87 @@ static void uv__udp_recvmsg(uv_udp_t* handle) {
 }
 
 
+#if defined(__linux__)
+/* Returns -ENOSYS when the kernel doesn't implement sendmmsg(), in which case
+ * the caller falls back to one sendmsg() call per request.
+ */
+static int uv__udp_sendmmsg(uv_udp_t* handle) {
+  uv_udp_send_t* reqs[UV__MMSG_MAXWIDTH];
+  struct uv__mmsghdr msgs[UV__MMSG_MAXWIDTH];
+  union uv__udp_cmsg_u ctl[UV__MMSG_MAXWIDTH];
+  uv_udp_send_t* req;
+  QUEUE* q;
+  int nsent;
+  int nreqs;
+  int i;
+
+  while (!QUEUE_EMPTY(&handle->write_queue)) {
+    nreqs = 0;
+    QUEUE_FOREACH(q, &handle->write_queue) {
+      if (nreqs == UV__MMSG_MAXWIDTH)
+        break;
+
+      req = QUEUE_DATA(q, uv_udp_send_t, queue);
+      uv__udp_prep_send(&msgs[nreqs].msg_hdr, req, &ctl[nreqs]);
+      reqs[nreqs++] = req;
+    }
+
+    do {
+      nsent = uv__sendmmsg(handle->io_watcher.fd, msgs, nreqs, 0);
+    } while (nsent == -1 && errno == EINTR);
+
+    if (nsent == -1) {
+      if (errno == ENOSYS)
+        return -ENOSYS;
+
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        uv__io_drained(&handle->io_watcher, UV__POLLOUT);
+        break;
+      }
+
+      /* sendmmsg() only reports an error when the first datagram fails, the
+       * others are retried on the next iteration.
+       */
+      reqs[0]->status = -errno;
+      QUEUE_REMOVE(&reqs[0]->queue);
+      QUEUE_INSERT_TAIL(&handle->write_completed_queue, &reqs[0]->queue);
+      continue;
+    }
+
+    /* Datagrams are atomic, see uv__udp_sendmsg(). A partially accepted batch
+     * leaves the remaining requests at the head of the write queue; the next
+     * call either sends them or reports why it can't.
+     */
+    for (i = 0; i < nsent; i++) {
+      reqs[i]->status = msgs[i].msg_len;
+      QUEUE_REMOVE(&reqs[i]->queue);
+      QUEUE_INSERT_TAIL(&handle->write_completed_queue, &reqs[i]->queue);
+    }
+  }
+
+  if (!QUEUE_EMPTY(&handle->write_completed_queue))
+    uv__io_feed(handle->loop, &handle->io_watcher);
+
+  return 0;
+}
+#endif
+
+
 static void uv__udp_sendmsg(uv_udp_t* handle) {
   uv_udp_send_t* req;
   QUEUE* q;
   struct msghdr h;
   ssize_t size;
+#if defined(__linux__)
+  union uv__udp_cmsg_u ctl;
+  static int no_sendmmsg;
+
+  if (no_sendmmsg == 0) {
+    if (uv__udp_sendmmsg(handle) == 0)
+      return;
+    no_sendmmsg = 1;
+  }
+#endif
 
   while (!QUEUE_EMPTY(&handle->write_queue)) {
     q = QUEUE_HEAD(&handle->write_queue);
@@ -217,19 +578,20 @@ static void uv__udp_sendmsg(uv_udp_t* handle) {
     req = QUEUE_DATA(q, uv_udp_send_t, queue);
     assert(req != NULL);
 
-    memset(&h, 0, sizeof h);
-    h.msg_name = &req->addr;
-    h.msg_namelen = (req->addr.ss_family == AF_INET6 ?
-      sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
-    h.msg_iov = (struct iovec*) req->bufs;
-    h.msg_iovlen = req->nbufs;
+#if defined(__linux__)
+    uv__udp_prep_send(&h, req, &ctl);
+#else
+    uv__udp_prep_send(&h, req, NULL);
+#endif
 
     do {
       size = sendmsg(handle->io_watcher.fd, &h, 0);
     } while (size == -1 && errno == EINTR);
 
-    if (size == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    if (size == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      uv__io_drained(&handle->io_watcher, UV__POLLOUT);
       break;
+    }
 
     req->status = (size == -1 ? -errno : size);
 
@@ -251,7 +613,7 @@ static void uv__udp_sendmsg(uv_udp_t* handle) {
  * Linux as of 3.9 has a SO_REUSEPORT socket option but with semantics that
  * are different from the BSDs: it _shares_ the port rather than steal it
  * from the current listener.  While useful, it's not something we can emulate
- * on other platforms so we don't enable it.
+ * on other platforms so we don't enable it here, UV_UDP_REUSEPORT asks for it.
  */
 static int uv__set_reuse(int fd) {
   int yes;
@@ -290,7 +652,8 @@ int uv__udp_bind(uv_udp_t* handle,
   }
 #endif
   /* Check for bad flags. */
-  if (flags & ~(UV_UDP_IPV6ONLY | UV_UDP_REUSEADDR))
+  if (flags & ~(UV_UDP_IPV6ONLY | UV_UDP_REUSEADDR | UV_UDP_RECVMMSG |
+                UV_UDP_REUSEPORT | UV_UDP_REUSEPORT_CPU))
     return -EINVAL;
     
   /* Cannot set IPv6-only mode on non-IPv6 socket. */
@@ -317,6 +680,17 @@ int uv__udp_bind(uv_udp_t* handle,
       goto out;
   }
 
+  if (flags & (UV_UDP_REUSEPORT | UV_UDP_REUSEPORT_CPU)) {
+    err = uv__set_reuseport(fd);
+    if (err)
+      goto out;
+  }
+
+#if defined(__linux__)
+  if (flags & UV_UDP_RECVMMSG)
+    handle->flags |= UV_HANDLE_UDP_RECVMMSG;
+#endif
+
   if (flags & UV_UDP_IPV6ONLY) {
 #ifdef IPV6_V6ONLY
     yes = 1;
@@ -335,6 +709,12 @@ int uv__udp_bind(uv_udp_t* handle,
     goto out;
   }
 
+  if (flags & UV_UDP_REUSEPORT_CPU) {
+    err = uv__reuseport_steer_cpu(fd);
+    if (err)
+      goto out;
+  }
+
   if (addr->sa_family == AF_INET6)
     handle->flags |= UV_HANDLE_IPV6;
 	  
@@ -399,11 +779,38 @@ int uv__udp_send(uv_udp_send_t* req,
                  const struct sockaddr* addr,
                  unsigned int addrlen,
                  uv_udp_send_cb send_cb) {
+  return uv__udp_send_segmented(req,
+                                handle,
+                                bufs,
+                                nbufs,
+                                addr,
+                                addrlen,
+                                0,
+                                send_cb);
+}
+
+
+int uv__udp_send_segmented(uv_udp_send_t* req,
+                           uv_udp_t* handle,
+                           const uv_buf_t bufs[],
+                           unsigned int nbufs,
+                           const struct sockaddr* addr,
+                           unsigned int addrlen,
+                           unsigned int segment_size,
+                           uv_udp_send_cb send_cb) {
   int err;
   int empty_queue;
 
   assert(nbufs > 0);
 
+#if defined(__linux__)
+  if (segment_size > 0xffff)
+    return -EINVAL;
+#else
+  if (segment_size != 0)
+    return -ENOTSUP;
+#endif
+
   err = uv__udp_maybe_deferred_bind(handle, addr->sa_family, 0);
   if (err)
     return err;
@@ -420,6 +827,7 @@ int uv__udp_send(uv_udp_send_t* req,
   req->send_cb = send_cb;
   req->handle = handle;
   req->nbufs = nbufs;
+  req->segment_size = segment_size;
 
   req->bufs = req->bufsml;
   if (nbufs > ARRAY_SIZE(req->bufsml))
@@ -434,8 +842,13 @@ int uv__udp_send(uv_udp_send_t* req,
   QUEUE_INSERT_TAIL(&handle->write_queue, &req->queue);
   uv__handle_start(handle);
 
-  if (empty_queue)
+  if (empty_queue) {
     uv__udp_sendmsg(handle);
+
+    /* The socket buffer may have been full, wait for it to drain. */
+    if (!QUEUE_EMPTY(&handle->write_queue))
+      uv__io_start(handle->loop, &handle->io_watcher, UV__POLLOUT);
+  }
   else
     uv__io_start(handle->loop, &handle->io_watcher, UV__POLLOUT);
 
@@ -575,7 +988,10 @@ int uv_udp_init(uv_loop_t* loop, uv_udp_t* handle) {
   handle->recv_cb = NULL;
   handle->send_queue_size = 0;
   handle->send_queue_count = 0;
+  handle->recv_mmsg_count = 0;
+  handle->recv_segment_size = 0;
   uv__io_init(&handle->io_watcher, uv__udp_io, -1);
+  uv__io_set_edge(&handle->io_watcher);
   QUEUE_INIT(&handle->write_queue);
   QUEUE_INIT(&handle->write_completed_queue);
   return 0;
@@ -652,6 +1068,23 @@ int uv_udp_set_broadcast(uv_udp_t* handle, int on) {
 }
 
 
+int uv_udp_set_gro(uv_udp_t* handle, int on) {
+#if defined(__linux__)
+  if (setsockopt(handle->io_watcher.fd, SOL_UDP, UV__UDP_GRO, &on, sizeof(on)))
+    return -errno;
+
+  if (on)
+    handle->flags |= UV_HANDLE_UDP_GRO;
+  else
+    handle->flags &= ~UV_HANDLE_UDP_GRO;
+
+  return 0;
+#else
+  return -ENOTSUP;
+#endif
+}
+
+
 int uv_udp_set_ttl(uv_udp_t* handle, int ttl) {
   if (ttl < 1 || ttl > 255)
     return -EINVAL;
@@ -746,7 +1179,9 @@ int uv__udp_recv_start(uv_udp_t* handle,
                        uv_udp_recv_cb recv_cb) {
   int err;
 
-  if (alloc_cb == NULL || recv_cb == NULL)
+  /* The alloc_cb is optional when the loop lends the buffers. */
+  if ((alloc_cb == NULL && !uv__read_pool_enabled(handle->loop)) ||
+      recv_cb == NULL)
     return -EINVAL;
 
   if (uv__io_active(&handle->io_watcher, UV__POLLIN))
@@ -30,6 +30,7 @@
 #include "uv-common.h"
 
 #include <stdio.h>
+#include <stdarg.h>
 #include <assert.h>
 #include <stddef.h> /* NULL */
 #include <stdlib.h> /* malloc */
@@ -241,6 +242,36 @@ int uv_udp_send(uv_udp_send_t* req,
 }
 
 
+int uv_udp_send_segmented(uv_udp_send_t* req,
+                          uv_udp_t* handle,
+                          const uv_buf_t bufs[],
+                          unsigned int nbufs,
+                          const struct sockaddr* addr,
+                          unsigned int segment_size,
+                          uv_udp_send_cb send_cb) {
+  unsigned int addrlen;
+
+  if (handle->type != UV_UDP || segment_size == 0)
+    return UV_EINVAL;
+
+  if (addr->sa_family == AF_INET)
+    addrlen = sizeof(struct sockaddr_in);
+  else if (addr->sa_family == AF_INET6)
+    addrlen = sizeof(struct sockaddr_in6);
+  else
+    return UV_EINVAL;
+
+  return uv__udp_send_segmented(req,
+                                handle,
+                                bufs,
+                                nbufs,
+                                addr,
+                                addrlen,
+                                segment_size,
+                                send_cb);
+}
+
+
 int uv_udp_try_send(uv_udp_t* handle,
                     const uv_buf_t bufs[],
                     unsigned int nbufs,
@@ -266,7 +297,9 @@ int uv_udp_try_send(uv_udp_t* handle,
 int uv_udp_recv_start(uv_udp_t* handle,
                       uv_alloc_cb alloc_cb,
                       uv_udp_recv_cb recv_cb) {
-  if (handle->type != UV_UDP || alloc_cb == NULL || recv_cb == NULL)
+  if (handle->type != UV_UDP || recv_cb == NULL)
+    return UV_EINVAL;
+  else if (alloc_cb == NULL && !uv__read_pool_enabled(handle->loop))
     return UV_EINVAL;
   else
     return uv__udp_recv_start(handle, alloc_cb, recv_cb);
@@ -420,6 +453,19 @@ uint64_t uv_now(const uv_loop_t* loop) {
 }
 
 
+int uv_loop_configure(uv_loop_t* loop, uv_loop_option option, ...) {
+  va_list ap;
+  int err;
+
+  va_start(ap, option);
+  /* Any platform-agnostic options should be handled here. */
+  err = uv__loop_configure(loop, option, ap);
+  va_end(ap);
+
+  return err;
+}
+
+
 
 size_t uv__count_bufs(const uv_buf_t bufs[], unsigned int nbufs) {
   unsigned int i;
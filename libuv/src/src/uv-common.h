@@ -28,6 +28,7 @@
 #define UV_COMMON_H_
 
 #include <assert.h>
+#include <stdarg.h>
 #include <stddef.h>
 
 #if defined(_MSC_VER) && _MSC_VER < 1600
@@ -59,6 +60,8 @@ enum {
 # define UV__HANDLE_CLOSING   0x01
 #endif
 
+int uv__loop_configure(uv_loop_t* loop, uv_loop_option option, va_list ap);
+
 int uv__tcp_bind(uv_tcp_t* tcp,
                  const struct sockaddr* addr,
                  unsigned int addrlen,
@@ -83,6 +86,15 @@ int uv__udp_send(uv_udp_send_t* req,
                  unsigned int addrlen,
                  uv_udp_send_cb send_cb);
 
+int uv__udp_send_segmented(uv_udp_send_t* req,
+                           uv_udp_t* handle,
+                           const uv_buf_t bufs[],
+                           unsigned int nbufs,
+                           const struct sockaddr* addr,
+                           unsigned int addrlen,
+                           unsigned int segment_size,
+                           uv_udp_send_cb send_cb);
+
 int uv__udp_try_send(uv_udp_t* handle,
                      const uv_buf_t bufs[],
                      unsigned int nbufs,
@@ -92,6 +104,8 @@ int uv__udp_try_send(uv_udp_t* handle,
 int uv__udp_recv_start(uv_udp_t* handle, uv_alloc_cb alloccb,
                        uv_udp_recv_cb recv_cb);
 
+int uv__read_pool_enabled(const uv_loop_t* loop);
+
 int uv__udp_recv_stop(uv_udp_t* handle);
 
 void uv__fs_poll_close(uv_fs_poll_t* handle);
@@ -100,6 +114,8 @@ int uv__getaddrinfo_translate_error(int sys_err);    /* EAI_* error. */
 
 void uv__work_submit(uv_loop_t* loop,
                      struct uv__work *w,
+                     uv_work_class cls,
+                     unsigned int type,
                      void (*work)(struct uv__work *w),
                      void (*done)(struct uv__work *w, int status));
 
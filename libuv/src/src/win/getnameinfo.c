@@ -138,6 +138,8 @@ int uv_getnameinfo(uv_loop_t* loop,
 
   uv__work_submit(loop,
                   &req->work_req,
+                  UV_WORK_SLOW_IO,
+                  UV_THREADPOOL_STATS_GETNAMEINFO,
                   uv__getnameinfo_work,
                   uv__getnameinfo_done);
 
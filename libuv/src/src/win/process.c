@@ -1245,3 +1245,52 @@ int uv_kill(int pid, int signum) {
 
   return err;  /* err is already translated. */
 }
+
+
+int uv_cluster_init(uv_loop_t* loop,
+                    uv_cluster_t* cluster,
+                    uv_cluster_mode mode,
+                    uv_cluster_exit_cb exit_cb) {
+  return UV_ENOTSUP;
+}
+
+
+int uv_cluster_spawn(uv_cluster_t* cluster,
+                     const uv_process_options_t* options) {
+  return UV_ENOTSUP;
+}
+
+
+int uv_cluster_listen(uv_cluster_t* cluster, int backlog) {
+  return UV_ENOTSUP;
+}
+
+
+int uv_cluster_kill(uv_cluster_t* cluster, int signum) {
+  return UV_ENOTSUP;
+}
+
+
+void uv_cluster_close(uv_cluster_t* cluster, uv_cluster_close_cb close_cb) {
+}
+
+
+int uv_cluster_worker_init(uv_loop_t* loop,
+                           uv_cluster_worker_t* worker,
+                           uv_cluster_connection_cb connection_cb) {
+  return UV_ENOTSUP;
+}
+
+
+int uv_cluster_accept(uv_cluster_worker_t* worker, uv_stream_t* client) {
+  return UV_ENOTSUP;
+}
+
+
+int uv_cluster_done(uv_cluster_worker_t* worker) {
+  return UV_ENOTSUP;
+}
+
+
+void uv_cluster_worker_close(uv_cluster_worker_t* worker) {
+}
@@ -96,6 +96,15 @@ int uv_read_start(uv_stream_t* handle, uv_alloc_cb alloc_cb,
 }
 
 
+int uv_read_start_framed(uv_stream_t* handle,
+                         unsigned int flags,
+                         int delimiter,
+                         size_t max_frame,
+                         uv_read_cb read_cb) {
+  return UV_ENOTSUP;
+}
+
+
 int uv_read_stop(uv_stream_t* handle) {
   int err;
 
@@ -189,6 +198,30 @@ int uv_try_write(uv_stream_t* stream,
 }
 
 
+int uv__read_pool_enabled(const uv_loop_t* loop) {
+  return 0;
+}
+
+
+void uv_buf_retain(const uv_buf_t* buf) {
+  /* There is no read buffer pool, the loop never lends buffers. */
+}
+
+
+void uv_buf_release(uv_loop_t* loop, const uv_buf_t* buf) {
+}
+
+
+int uv_write_file(uv_write_t* req,
+                  uv_stream_t* handle,
+                  uv_file file,
+                  int64_t offset,
+                  size_t length,
+                  uv_write_cb cb) {
+  return UV_ENOTSUP;
+}
+
+
 int uv_shutdown(uv_shutdown_t* req, uv_stream_t* handle, uv_shutdown_cb cb) {
   uv_loop_t* loop = handle->loop;
 
@@ -222,6 +255,24 @@ int uv_is_writable(const uv_stream_t* handle) {
 }
 
 
+int uv_stream_set_cork(uv_stream_t* handle, int enable) {
+  return UV_ENOTSUP;
+}
+
+
+int uv_stream_flush(uv_stream_t* handle) {
+  return 0;
+}
+
+
+int uv_stream_set_watermarks(uv_stream_t* handle,
+                             size_t high,
+                             size_t low,
+                             uv_watermark_cb cb) {
+  return UV_ENOTSUP;
+}
+
+
 int uv_stream_set_blocking(uv_stream_t* handle, int blocking) {
   if (handle->type != UV_NAMED_PIPE)
     return UV_EINVAL;
@@ -233,3 +284,18 @@ int uv_stream_set_blocking(uv_stream_t* handle, int blocking) {
 
   return 0;
 }
+
+
+int uv_splice_start(uv_loop_t* loop,
+                    uv_splice_t* splice,
+                    uv_stream_t* source,
+                    uv_stream_t* dest,
+                    unsigned int flags,
+                    uv_splice_cb cb) {
+  return UV_ENOTSUP;
+}
+
+
+int uv_splice_stop(uv_splice_t* splice) {
+  return UV_ENOTSUP;
+}
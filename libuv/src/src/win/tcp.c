@@ -261,6 +261,9 @@ static int uv_tcp_try_bind(uv_tcp_t* handle,
     if ((flags & UV_TCP_IPV6ONLY) && addr->sa_family != AF_INET6)
       return ERROR_INVALID_PARAMETER;
 
+    if (flags & (UV_TCP_REUSEPORT | UV_TCP_REUSEPORT_CPU))
+      return ERROR_NOT_SUPPORTED;
+
     sock = socket(addr->sa_family, SOCK_STREAM, 0);
     if (sock == INVALID_SOCKET) {
       return WSAGetLastError();
@@ -1271,6 +1274,31 @@ int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable) {
 }
 
 
+int uv_tcp_exclusive_accept(uv_tcp_t* handle, int enable) {
+  return UV_ENOTSUP;
+}
+
+
+int uv_tcp_notsent_lowat(uv_tcp_t* handle, unsigned int bytes) {
+  return UV_ENOTSUP;
+}
+
+
+int uv_tcp_connect_host(uv_connect_host_t* req,
+                        uv_tcp_t* handle,
+                        const char* node,
+                        const char* service,
+                        unsigned int delay,
+                        uv_connect_host_cb cb) {
+  return UV_ENOTSUP;
+}
+
+
+int uv_tcp_zerocopy(uv_tcp_t* handle, int enable, size_t threshold) {
+  return UV_ENOTSUP;
+}
+
+
 static int uv_tcp_try_cancel_io(uv_tcp_t* tcp) {
   SOCKET socket = tcp->socket;
   int non_ifs_lsp;
@@ -69,6 +69,52 @@ int uv_queue_work(uv_loop_t* loop, uv_work_t* req, uv_work_cb work_cb,
 }
 
 
+int uv_threadpool_set_limits(unsigned int min, unsigned int max) {
+  return UV_ENOSYS;
+}
+
+
+int uv_threadpool_stats(uv_loop_t* loop, uv_threadpool_stats_t* stats) {
+  return UV_ENOSYS;
+}
+
+
+int uv_queue_work_class(uv_loop_t* loop,
+                        uv_work_t* req,
+                        uv_work_class cls,
+                        uv_work_cb work_cb,
+                        uv_after_work_cb after_work_cb) {
+  return uv_queue_work(loop, req, work_cb, after_work_cb);
+}
+
+
+void uv_work_batch_begin(uv_loop_t* loop) {
+}
+
+
+void uv_work_batch_end(uv_loop_t* loop) {
+}
+
+
+int uv_queue_work_batch(uv_loop_t* loop,
+                        uv_work_t* reqs[],
+                        unsigned int nreqs,
+                        uv_work_class cls,
+                        uv_work_cb work_cb,
+                        uv_after_work_cb after_work_cb) {
+  unsigned int i;
+  int err;
+
+  for (i = 0; i < nreqs; i++) {
+    err = uv_queue_work(loop, reqs[i], work_cb, after_work_cb);
+    if (err)
+      return err;
+  }
+
+  return 0;
+}
+
+
 int uv_cancel(uv_req_t* req) {
   return UV_ENOSYS;
 }
@@ -132,6 +132,8 @@ int uv_udp_init(uv_loop_t* loop, uv_udp_t* handle) {
   handle->func_wsarecvfrom = WSARecvFrom;
   handle->send_queue_size = 0;
   handle->send_queue_count = 0;
+  handle->recv_mmsg_count = 0;
+  handle->recv_segment_size = 0;
 
   uv_req_init(loop, (uv_req_t*) &(handle->recv_req));
   handle->recv_req.type = UV_UDP_RECV;
@@ -178,6 +180,9 @@ static int uv_udp_maybe_bind(uv_udp_t* handle,
     return ERROR_INVALID_PARAMETER;
   }
 
+  if (flags & (UV_UDP_REUSEPORT | UV_UDP_REUSEPORT_CPU))
+    return ERROR_NOT_SUPPORTED;
+
   if (handle->socket == INVALID_SOCKET) {
     SOCKET sock = socket(addr->sa_family, SOCK_DGRAM, 0);
     if (sock == INVALID_SOCKET) {
@@ -728,6 +733,11 @@ int uv_udp_set_multicast_interface(uv_udp_t* handle, const char* interface_addr)
 }
 
 
+int uv_udp_set_gro(uv_udp_t* handle, int on) {
+  return UV_ENOTSUP;
+}
+
+
 int uv_udp_set_broadcast(uv_udp_t* handle, int value) {
   BOOL optval = (BOOL) value;
 
@@ -876,6 +886,18 @@ int uv__udp_send(uv_udp_send_t* req,
 }
 
 
+int uv__udp_send_segmented(uv_udp_send_t* req,
+                           uv_udp_t* handle,
+                           const uv_buf_t bufs[],
+                           unsigned int nbufs,
+                           const struct sockaddr* addr,
+                           unsigned int addrlen,
+                           unsigned int segment_size,
+                           uv_udp_send_cb send_cb) {
+  return UV_ENOTSUP;
+}
+
+
 int uv__udp_try_send(uv_udp_t* handle,
                      const uv_buf_t bufs[],
                      unsigned int nbufs,